@@ -0,0 +1,87 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Switch event queue.
+
+   The library variable 'last_switched_id' only ever records the
+   latest switch to be switched, so if two or more switches complete
+   their transitions before the sketch looks, the earlier ones are
+   lost. Establishing the switch event queue ('switch_events') means
+   every transition is queued by the read functions as an event of:
+     - the switch_id,
+     - the kind of event (toggle_on_event, toggle_off_event or
+       button_cycle_event), and
+     - the time of the event (millisecs).
+
+   Here, all switches are scanned in one go with read_all_switches and
+   any events are then drained in a batch and reported on the serial
+   monitor. The queue is a lock-free, single producer/single consumer
+   queue, so events may equally be drained in an ISR.
+
+   The sketch is configured for 4 switches, 2 toggle and 2 button,
+   all wired as circuit_C2 (no resistors needed).
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+#define num_switches     4
+#define queue_size       8  // must be a power of 2, 2-128
+
+byte my_switches[num_switches][2] =
+{
+  // switch type, digital pin
+  toggle_switch, 2,
+  toggle_switch, 3,
+  button_switch, 4,
+  button_switch, 5
+};
+
+Switches ms(num_switches);
+
+switch_event my_events[queue_size];  // storage for the event queue
+
+void setup() {
+  Serial.begin(115200);
+  for (byte sw = 0; sw < num_switches; sw++) {
+    ms.add_switch(my_switches[sw][0], my_switches[sw][1], circuit_C2);
+  }
+  if (ms.switch_events.begin(my_events, queue_size) == queue_failure) {
+    Serial.println(F("!!Failure to establish event queue - PROGRAM TERMINATED!!"));
+    Serial.flush();
+    exit(1);
+  }
+}
+
+void loop() {
+  ms.read_all_switches();  // scan every switch, queuing any events
+  switch_event batch[queue_size];
+  byte num_events = ms.switch_events.pop_events(batch, queue_size);
+  for (byte e = 0; e < num_events; e++) {
+    Serial.print(batch[e].event_time);
+    Serial.print(F(" msecs, switch id "));
+    Serial.print(batch[e].switch_id);
+    switch (batch[e].event_kind) {
+      case toggle_on_event:
+        Serial.println(F(" toggled ON"));
+        break;
+      case toggle_off_event:
+        Serial.println(F(" toggled OFF"));
+        break;
+      case button_cycle_event:
+        Serial.println(F(" pressed & released"));
+        break;
+    }
+  }
+  if (ms.switch_events.overflows > 0) {
+    Serial.print(F("events lost: "));
+    Serial.println(ms.switch_events.overflows);
+    ms.switch_events.overflows = 0;
+  }
+}
@@ -0,0 +1,75 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Switch handlers.
+
+   Rather than reading each switch in turn and routing those switched
+   through if/switch-case statements, each switch is given a handler
+   function, called with the switch_id, the kind of event and a
+   context given when the handler is set. A single 'poll' call each
+   time round loop() then reads all switches and calls the handlers of
+   just those that switched.
+
+   The sketch is configured for 4 switches:
+   toggle switch on pin 2 turns a led on pin 10 on and off, its handler
+                          being given the led pin as its context
+   toggle switch on pin 3 does the same for a led on pin 11, with the
+                          same handler
+   button switch on pin 4 prints the switch control data
+   button switch on pin 5 has no handler of its own, so is dealt with
+                          by the handler set for all button presses
+   All switches are wired as circuit_C2, ie no other components.
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+#define num_switches  4
+
+uint8_t led_1 = 10;
+uint8_t led_2 = 11;
+
+Switches my_switches(num_switches);
+
+// Toggle switch handler, 'context' points to the led pin to switch
+void switch_led(uint8_t switch_id, uint8_t event_kind, void *context) {
+  uint8_t led_pin = *(uint8_t *)context;
+  digitalWrite(led_pin, event_kind == toggle_on_event ? HIGH : LOW);
+}
+
+// Button switch handler, print the switch control data
+void report(uint8_t switch_id, uint8_t event_kind, void *context) {
+  my_switches.print_switches();
+}
+
+// Handler for any button press cycle not otherwise handled
+void any_button(uint8_t switch_id, uint8_t event_kind, void *context) {
+  Serial.print(F("button switch_id "));
+  Serial.print(switch_id);
+  Serial.println(F(" pressed"));
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(led_1, OUTPUT);
+  pinMode(led_2, OUTPUT);
+  my_switches.set_switch_handler(my_switches.add_switch(toggle_switch, 2, circuit_C2), switch_led, &led_1);
+  my_switches.set_switch_handler(my_switches.add_switch(toggle_switch, 3, circuit_C2), switch_led, &led_2);
+  my_switches.set_switch_handler(my_switches.add_switch(button_switch, 4, circuit_C2), report);
+  my_switches.add_switch(button_switch, 5, circuit_C2);
+  if (my_switches.set_event_handler(button_cycle_event, any_button) != handler_success) {
+    Serial.println(F("!!Failure to set handlers - PROGRAM TERMINATED!!"));
+    Serial.flush();
+    exit(1);
+  }
+}
+
+void loop() {
+  my_switches.poll();  // read all switches, calling the handlers of any switched
+}
@@ -0,0 +1,67 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Matrix keypad.
+
+   A common 4 x 4 membrane keypad is added with 'add_matrix', its 16
+   keys then being switches like any other, with switch_ids in row
+   order from the switch_id returned. Only 8 pins are needed, 4 rows
+   and 4 columns, with no other components.
+
+   Every key is set to report as soon as it is pressed (see
+   'set_button_mode'), and the whole keypad is read with a single
+   'read_all_switches' call each time round loop(), the key pressed
+   being printed on the serial monitor.
+
+   Membrane keypads have no diodes, so pressing three keys at the
+   corners of a rectangle would make the fourth appear pressed. This
+   is suppressed by the library, the keys of such a rectangle keeping
+   their previous state until one is released.
+
+   The sketch is configured for:
+   rows on pins 2-5 and columns on pins 6-9, as keypad pins 1-8
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+#define num_rows         4
+#define num_cols         4
+
+const uint8_t row_pins[num_rows] = {2, 3, 4, 5};
+const uint8_t col_pins[num_cols] = {6, 7, 8, 9};
+
+const char key_legends[num_rows * num_cols + 1] = "123A456B789C*0#D";
+
+Switches my_keypad(num_rows * num_cols);
+
+int first_key;  // switch_id of the top left key
+
+void setup() {
+  Serial.begin(115200);
+  first_key = my_keypad.add_matrix(row_pins, num_rows, col_pins, num_cols, button_switch, false);
+  if (first_key < 0) {
+    Serial.println(F("!!Failure to add keypad - PROGRAM TERMINATED!!"));
+    Serial.flush();
+    exit(1);
+  }
+  for (byte key = 0; key < num_rows * num_cols; key++) {
+    my_keypad.set_button_mode(first_key + key, button_press_mode);
+  }
+}
+
+void loop() {
+  uint32_t keys_pressed = my_keypad.read_all_switches();  // one bit per switch_id
+  for (byte key = 0; key < num_rows * num_cols; key++) {
+    if ((keys_pressed >> (first_key + key)) & 1) {
+      Serial.print(F("key "));
+      Serial.println(key_legends[key]);
+    }
+  }
+}
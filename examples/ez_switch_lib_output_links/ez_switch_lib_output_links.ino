@@ -0,0 +1,59 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Multiple outputs linked to a switch.
+
+   A toggle switch drives three outputs with no end user coding, each
+   linked with 'add_output_link':
+     a led that follows the switch, on whilst the switch is on,
+     a relay module, active LOW, that follows the switch,
+     a buzzer sounded for 200 millisecs each time the switch switches.
+   A button switch also flips a second led each time it is pressed.
+
+   The outputs changed by each 'read_all_switches' call are written
+   together, one register write per port, so the led and relay switch
+   at the same instant.
+
+   The sketch is configured for:
+   toggle switch on pin 2 and button switch on pin 3, both circuit_C2,
+   leds on pins 8 and 9, relay module on pin 10, buzzer on pin 11.
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+#define toggle_pin       2
+#define button_pin       3
+#define led_1            8
+#define led_2            9
+#define relay           10
+#define buzzer          11
+
+Switches my_switches(2);
+
+Switches::output_link my_links[4];  // storage for the output links
+
+void setup() {
+  Serial.begin(115200);
+  int toggle_id = my_switches.add_switch(toggle_switch, toggle_pin, circuit_C2);
+  int button_id = my_switches.add_switch(button_switch, button_pin, circuit_C2);
+  my_switches.set_output_links(my_links, 4);
+  if (my_switches.add_output_link(toggle_id, led_1, link_follow) < 0 ||
+      my_switches.add_output_link(toggle_id, relay, link_follow, LOW) < 0 ||
+      my_switches.add_output_link(toggle_id, buzzer, link_pulse, HIGH, 200) < 0 ||
+      my_switches.add_output_link(button_id, led_2, link_toggle) < 0) {
+    Serial.println(F("!!Failure to link outputs - PROGRAM TERMINATED!!"));
+    Serial.flush();
+    exit(1);
+  }
+}
+
+void loop() {
+  my_switches.read_all_switches();  // reads the switches and drives the outputs
+}
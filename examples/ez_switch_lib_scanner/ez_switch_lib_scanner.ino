@@ -0,0 +1,78 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Scanning switches in their own task.
+
+   A Switch_scanner scans the switches every 2 millisecs, whatever
+   loop() is doing - here, deliberately slow work. On the ESP32 the
+   scanner runs as a FreeRTOS task on core 0, loop() running on core 1.
+   On other boards scan_once, which scans when a scan is due, is called
+   from yield(), which the Arduino core calls whilst in delay(), or on
+   the RP2040 from loop1(), so on the second core.
+
+   loop() never reads the switches itself. It takes the switch events
+   from the event queue, none being lost however long loop() takes,
+   and a consistent copy of all switch states from the scanner.
+
+   The sketch is configured for:
+   toggle switch on pin 2 and button switches on pins 3 and 4, all
+   circuit_C2, with a led on pin 10 linked to the toggle switch.
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+#define num_switches  3
+#define led          10
+
+Switches my_switches(num_switches);
+Switch_scanner my_scanner(my_switches);
+
+switch_event my_events[16];  // switch events waiting for loop()
+
+void setup() {
+  Serial.begin(115200);
+  my_switches.add_switch(toggle_switch, 2, circuit_C2);
+  my_switches.add_switch(button_switch, 3, circuit_C2);
+  my_switches.add_switch(button_switch, 4, circuit_C2);
+  my_switches.link_switch_to_output(0, led, LOW);  // driven by the scanner
+  my_switches.switch_events.begin(my_events, 16);
+  if (my_scanner.start(2) != scanner_success) {
+    Serial.println(F("!!Failure to start the scanner - PROGRAM TERMINATED!!"));
+    Serial.flush();
+    exit(1);
+  }
+}
+
+#if !ez_scanner_task
+#if defined(ARDUINO_ARCH_RP2040)
+void loop1() {
+  my_scanner.scan_once();  // scanning on the second core
+}
+#else
+void yield() {
+  my_scanner.scan_once();  // scanning whilst loop() is in delay()
+}
+#endif
+#endif
+
+void loop() {
+  switch_event event;
+  while (my_switches.switch_events.pop(event)) {
+    Serial.print(F("switch_id "));
+    Serial.print(event.switch_id);
+    Serial.print(F(" event "));
+    Serial.println(event.event_kind);
+  }
+  uint32_t on_bits[ez_switch_words(num_switches)];
+  my_scanner.read_states(on_bits, NULL, ez_switch_words(num_switches));
+  Serial.print(F("switches on "));
+  Serial.println(on_bits[0], BIN);
+  delay(500);  // slow application work, switches still scanned
+}
@@ -0,0 +1,67 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Switches on shift registers.
+
+   Two daisy chained 74HC165 shift registers give 16 switch inputs for
+   just 3 pins. The chain is added as an input bank with 'add_bank',
+   and a button switch added on each of its inputs with
+   'add_bank_switch'.
+
+   Each time round loop() 'read_all_switches' clocks the whole chain
+   in once, then debounces all 16 switches from the inputs read, the
+   button switched being printed on the serial monitor.
+
+   The sketch is configured for:
+   74HC165 PL (pin 1) on pin 8, CP (pin 2) on pin 12 and Q7 (pin 9),
+   of the first chip, on pin 11, CE (pin 15) to 0v, the first chip's DS
+   (pin 10) to Q7 of the second chip, and that of the second to 0v.
+   Each button is wired between an input (D0-D7) and 0v, with a 10k
+   ohm pull up resistor from the input to 5v, ie circuit_C2 wiring.
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+#define load_pin         8
+#define clock_pin       12
+#define data_pin        11
+#define num_chips        2
+#define num_buttons     (num_chips * 8)
+
+Shift_in_bank<num_chips> my_chain(load_pin, clock_pin, data_pin);
+
+Switches my_switches(num_buttons);
+
+int first_button;  // switch_id of the button on input 0
+
+void setup() {
+  Serial.begin(115200);
+  my_chain.begin();
+  int bank_id = my_switches.add_bank(my_chain);
+  for (byte input = 0; input < num_buttons; input++) {
+    int switch_id = my_switches.add_bank_switch(button_switch, bank_id, input, circuit_C2);
+    if (switch_id < 0) {
+      Serial.println(F("!!Failure to add a switch - PROGRAM TERMINATED!!"));
+      Serial.flush();
+      exit(1);
+    }
+    if (input == 0) first_button = switch_id;
+  }
+}
+
+void loop() {
+  uint32_t buttons_switched = my_switches.read_all_switches();  // one bit per switch_id
+  for (byte input = 0; input < num_buttons; input++) {
+    if ((buttons_switched >> (first_button + input)) & 1) {
+      Serial.print(F("button on input "));
+      Serial.println(input);
+    }
+  }
+}
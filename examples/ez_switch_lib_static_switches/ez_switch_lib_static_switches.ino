@@ -0,0 +1,68 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Compile time configured switches, no heap memory used.
+
+   Two switch declaration styles are shown:
+   1. 'Static_switches<N>' - used exactly as the Switches class, but
+      the switch control structure for its N switches is held in
+      static memory, so there is no malloc and no risk of heap
+      fragmentation.
+   2. 'Fixed_switch<type, pin, circuit>' - a single switch whose set
+      up is known at compile time. The parameters are checked by the
+      compiler (try changing 'circuit_C2' to '99') and each read
+      compiles to straight-line code for that switch type and circuit.
+
+   The sketch is configured for:
+   2 button switches, via Static_switches, linked to leds
+   1 toggle switch, via Fixed_switch, linked to a led
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+#define num_buttons      2
+
+#define button_pin_1     2
+#define button_pin_2     3
+#define toggle_pin       4
+
+#define led_1            8
+#define led_2            9
+#define led_3           10
+
+Static_switches<num_buttons> my_buttons;  // static storage for 2 switches
+
+Fixed_switch<toggle_switch, toggle_pin, circuit_C2> my_toggle;
+
+void setup() {
+  Serial.begin(115200);
+  int switch_id;
+  switch_id = my_buttons.add_switch(button_switch, button_pin_1, circuit_C2);
+  my_buttons.link_switch_to_output(switch_id, led_1, LOW);
+  switch_id = my_buttons.add_switch(button_switch, button_pin_2, circuit_C2);
+  my_buttons.link_switch_to_output(switch_id, led_2, LOW);
+
+  my_toggle.begin();  // establish the toggle switch pin
+  my_toggle.link_switch_to_output(led_3, LOW);
+}
+
+void loop() {
+  for (byte sw = 0; sw < num_buttons; sw++) {
+    if (my_buttons.read_switch(sw) == switched) {
+      Serial.print(F("button switch "));
+      Serial.print(sw);
+      Serial.println(F(" pressed"));
+    }
+  }
+  if (my_toggle.read_switch() == switched) {
+    Serial.print(F("toggle switch is now "));
+    Serial.println(my_toggle.switch_status == on ? F("ON") : F("OFF"));
+  }
+}
@@ -0,0 +1,54 @@
+/*
+   Ron D Bentley, Stafford, UK
+   Oct 2026
+
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+   -          Example of use of the ez_switch_lib library           -
+   Recording a switch pin trace.
+
+   Every contact change of two switches, bounce included, is recorded
+   with its time, a few bytes per change, by a Switch_trace recorder
+   and streamed out over the serial port in binary. Capture the serial
+   output to a file, eg with a serial terminal's 'log to file', then
+   replay it on a PC with the native replay tool, eg
+     cd extras/native
+     make replay TRACE=my_trace.bin
+   to see the switch events given by the switches' debounce periods,
+   or by others, eg
+     build/ez_switch_replay -d 5 my_trace.bin
+
+   The serial port carries ONLY the trace, so nothing else may be
+   printed by the sketch.
+
+   The sketch is configured for:
+   toggle switch on pin 2 and button switch on pin 3, both circuit_C2.
+   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+   This example and code is in the public domain and
+   may be used without restriction and without warranty.
+
+*/
+#include <ez_switch_lib.h>
+
+Switches my_switches(2);
+
+uint8_t my_trace_buffer[128];  // trace waiting to be sent
+Switch_trace my_trace;
+
+void setup() {
+  Serial.begin(115200);
+  my_switches.add_switch(toggle_switch, 2, circuit_C2);
+  my_switches.add_switch(button_switch, 3, circuit_C2);
+  if (my_trace.begin(my_trace_buffer, sizeof(my_trace_buffer)) != trace_success) {
+    exit(1);  // buffer too small
+  }
+  my_trace.record_all();
+  my_switches.set_trace(&my_trace);
+  my_switches.write_trace_header(Serial);
+}
+
+void loop() {
+  my_switches.read_switch(0);
+  my_switches.read_switch(1);
+  my_trace.drain(Serial, Serial.availableForWrite());  // never waits on the serial port
+}
@@ -0,0 +1,105 @@
+// Arduino Switch Library - minimal Arduino core for native (host) builds.
+//
+// Provides just enough of the Arduino API for the ez_switch_lib sources
+// to compile and run on a host machine (Linux). All pin and clock
+// functions are serviced by the GPIO/virtual clock simulator, see
+// ez_switch_sim.h, with pins grouped into 8 bit ports as on AVR boards.
+//
+// This header must NEVER be placed on the include path of a real
+// Arduino build.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_native_arduino_h
+#define ez_native_arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ez_switch_native   1       // identifies a native (host) build
+
+#define HIGH            0x1
+#define LOW             0x0
+
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Pin, port and clock functions, provided by the simulator
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+#define ez_sim_num_pins   256
+#define ez_sim_num_ports  (ez_sim_num_pins / 8)
+
+extern volatile uint8_t ez_sim_port[ez_sim_num_ports];  // pin levels, 8 pins per port
+
+int      digitalRead (uint8_t pin);
+void     digitalWrite(uint8_t pin, uint8_t level);
+void     pinMode     (uint8_t pin, uint8_t mode);
+uint32_t millis      ();
+uint32_t micros      ();
+void     delay       (uint32_t ms);
+void     noInterrupts();
+void     interrupts  ();
+
+#define digitalPinToPort(pin)     ((uint8_t)((pin) >> 3))
+#define digitalPinToBitMask(pin)  ((uint8_t)(1 << ((pin) & 7)))
+#define portInputRegister(port)   (&ez_sim_port[(port)])
+#define portOutputRegister(port)  (&ez_sim_port[(port)])
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Serial output, written to stdout
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+#define F(string_literal) (string_literal)
+
+#define DEC             10
+#define HEX             16
+#define OCT              8
+#define BIN              2
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual void   flush() {}
+
+    size_t print  (const char *s);
+    size_t print  (char c);
+    size_t print  (unsigned long n, int base = 10);
+    size_t print  (long n, int base = 10);
+    size_t print  (unsigned int n, int base = 10)  { return print((unsigned long)n, base); }
+    size_t print  (int n, int base = 10)           { return print((long)n, base); }
+    size_t print  (unsigned char n, int base = 10) { return print((unsigned long)n, base); }
+    size_t print  (double n, int digits = 2);
+    size_t println();
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return n + println(); }
+};
+
+class HardwareSerial : public Print
+{
+  public:
+    void   begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    void   flush();
+    int    availableForWrite() { return 0x7FFF; }  // stdout, never waits
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,112 @@
+// Arduino Switch Library - mock input banks for native builds.
+//
+//   Mock_bank<inputs> - an input bank (see ez_input_bank.h) whose inputs
+//                       are set directly by the test, eg
+//                         Mock_bank<16> bank;
+//                         bank.set_input(3, LOW);
+//                       The inputs are only seen by the switches once
+//                       fetched, as with a real bank, and the fetches
+//                       made are counted.
+//
+//   Mock_wire         - a Wire-like I2C bus holding one GPIO expander,
+//                       with 32 byte-wide registers, for testing
+//                       I2c_bank, eg
+//                         Mock_wire wire(0x20);
+//                         I2c_bank<Mock_wire, 2> bank(wire, 0x20, 0x12);
+//                         wire.reg[0x12] = 0xFE;   // GPIOA bit 0 LOW
+//                       Register reads auto-increment, as the MCP23017
+//                       in its default (sequential) mode. Setting 'fail'
+//                       makes transactions fail, as a missing device.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_mock_bank_h
+#define ez_mock_bank_h
+#include <Arduino.h>
+#include "ez_input_bank.h"
+
+template <uint8_t inputs>
+class Mock_bank : public Input_bank
+{
+  public:
+    Mock_bank() {
+      bits       = _bits;
+      num_inputs = inputs;
+      for (uint8_t byte = 0; byte < sizeof(_bits); byte++) _inputs[byte] = _bits[byte] = 0xFF;
+    }
+
+    void fetch() {
+      for (uint8_t byte = 0; byte < sizeof(_bits); byte++) _bits[byte] = _inputs[byte];
+      fetches++;
+    }
+
+    void set_input(uint8_t input, uint8_t level) {
+      if (level == HIGH) _inputs[input / 8] |= 1 << (input % 8);
+      else _inputs[input / 8] &= ~(1 << (input % 8));
+    }
+
+    uint32_t fetches = 0;  // fetch calls made
+
+  private:
+    uint8_t _inputs[(inputs + 7) / 8];  // levels as at the bank's pins
+    uint8_t _bits[(inputs + 7) / 8];    // levels as last fetched
+};
+
+class Mock_wire
+{
+  public:
+    Mock_wire(uint8_t address) : _address(address) {
+      for (uint8_t r = 0; r < sizeof(reg); r++) reg[r] = 0xFF;
+    }
+
+    void beginTransmission(uint8_t address) {
+      _target  = address;
+      _written = 0;
+    }
+
+    size_t write(uint8_t value) {
+      if (_written++ == 0) _pointer = value % sizeof(reg);  // first byte written sets the register
+      return 1;
+    }
+
+    uint8_t endTransmission(bool stop = true) {
+      (void)stop;
+      transactions++;
+      return (fail || _target != _address) ? 2 : 0;  // 2, address NACK
+    }
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity) {
+      transactions++;
+      _available = (fail || address != _address) ? 0 : quantity;
+      return _available;
+    }
+
+    int available() {
+      return _available;
+    }
+
+    int read() {
+      if (_available == 0) return -1;
+      _available--;
+      uint8_t value = reg[_pointer];
+      _pointer = (_pointer + 1) % sizeof(reg);
+      return value;
+    }
+
+    uint8_t  reg[32];           // the expander's registers
+    bool     fail = false;      // all transactions fail
+    uint32_t transactions = 0;  // transactions made, writes and reads
+
+  private:
+    uint8_t _address;
+    uint8_t _target    = 0;
+    uint8_t _written   = 0;
+    uint8_t _pointer   = 0;
+    uint8_t _available = 0;
+};
+
+#endif
@@ -0,0 +1,277 @@
+// Arduino Switch Library - native read path benchmark.
+//
+// Runs ez_switch_lib against the simulated GPIO/virtual clock and
+// reports the memory needed per switch and:
+//   1. the cost of a single read_switch call (ns), idle and in transition,
+//   2. full scans per second for 8, 64 and 255 switches, by read_switch
+//      calls and by the batched read_all_switches scan, with each of
+//      the standard and vertical (bit-sliced) debounce engines, and
+//      by read_all_switches for 64 switches on a (mock) input bank,
+//   3. the cost of an interrupt driven scan_dirty_switches when idle and
+//      with one switch marked dirty by the simulated interrupt source,
+//   4. debounce-to-report latency (virtual millisecs) for a bouncing
+//      toggle switch and button switch, scanned every millisec, with
+//      each of the debounce engines, and with adaptive debounce.
+//
+// Timings 1. to 3. are host wall clock timings, so are only comparable
+// between runs on the same machine, but are sufficient for catching
+// throughput regressions. Timings 4. are exact, being measured on the
+// virtual clock.
+//
+// Usage: ez_switch_bench [min_millisecs_per_measurement]
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <stdio.h>
+#include <chrono>
+#include "ez_switch_lib.h"
+#include "ez_switch_sim.h"
+#include "ez_mock_bank.h"
+
+static uint32_t min_run_ms = 200;     // minimum wall clock time per measurement
+static volatile uint32_t sink = 0;    // defeats optimising away of reads
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ns(bench_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Add 'num' switches on pins 0 to num-1, alternating button/toggle
+// switches and circuit_C1/circuit_C2 wiring.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void add_panel(Switches &panel, uint8_t num) {
+  for (uint16_t sw = 0; sw < num; sw++) {
+    panel.add_switch((sw & 1) ? toggle_switch : button_switch,
+                     sw,
+                     (sw & 2) ? circuit_C2 : circuit_C1);
+  }
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Run full scans until at least 'min_run_ms' has elapsed, returning the
+// mean ns per scan. A scan is either read_switch for every switch
+// ('per_switch') or read_all_switches with the given debounce engine.
+// With the vertical engine the virtual clock is advanced a sample
+// interval per scan, so that every scan samples and debounces.
+// If 'busy' then every switch input is held 'on' so that all switches
+// stay in their transition (pending) path.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+#define per_switch 255
+
+static double time_scans(uint8_t num, bool busy, uint8_t engine = per_switch) {
+  ez_sim_reset();
+  Switches panel(num);
+  add_panel(panel, num);
+  if (engine != per_switch) panel.set_debounce_engine(engine);
+  if (busy) {
+    for (uint16_t sw = 0; sw < num; sw++) {
+      ez_sim_set_pin(sw, (sw & 2) ? LOW : HIGH);  // 'on' for the switch's circuit
+    }
+  }
+  uint32_t scans = 0;
+  uint32_t batch = 1000;
+  uint32_t switched_mask[ez_switch_words(255)];
+  bench_clock::time_point start = bench_clock::now();
+  double ns;
+  do {
+    for (uint32_t n = 0; n < batch; n++) {
+      if (engine == vertical_debounce) {
+        ez_sim_advance_ms(4);
+        sink += panel.read_all_switches(switched_mask);
+      } else if (engine == standard_debounce) {
+        sink += panel.read_all_switches(switched_mask);
+      } else {
+        for (uint8_t sw = 0; sw < num; sw++) {
+          sink += panel.read_switch(sw);
+        }
+      }
+    }
+    scans += batch;
+    ns = elapsed_ns(start);
+  } while (ns < min_run_ms * 1e6);
+  return ns / scans;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// As time_scans for read_all_switches with the standard engine, but with
+// the 64 switches on a mock input bank, so one bank fetch per scan.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static double time_bank_scans() {
+  ez_sim_reset();
+  Mock_bank<64> bank;
+  Switches panel(64);
+  uint8_t bank_id = panel.add_bank(bank);
+  for (uint8_t sw = 0; sw < 64; sw++) {
+    panel.add_bank_switch((sw & 1) ? toggle_switch : button_switch, bank_id, sw,
+                          (sw & 2) ? circuit_C2 : circuit_C1);
+  }
+  uint32_t scans = 0;
+  uint32_t batch = 1000;
+  uint32_t switched_mask[ez_switch_words(64)];
+  bench_clock::time_point start = bench_clock::now();
+  double ns;
+  do {
+    for (uint32_t n = 0; n < batch; n++) {
+      sink += panel.read_all_switches(switched_mask);
+    }
+    scans += batch;
+    ns = elapsed_ns(start);
+  } while (ns < min_run_ms * 1e6);
+  return ns / scans;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Run interrupt driven scans until at least 'min_run_ms' has elapsed,
+// returning the mean ns per scan. If 'one_dirty' then a switch contact
+// is flipped before each scan, marking it dirty via the simulated pin
+// change interrupt.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static Switches *dirty_panel = NULL;
+
+static void dirty_isr(uint8_t pin) {
+  dirty_panel->mark_pin_dirty(pin);
+}
+
+static double time_dirty_scans(uint8_t num, bool one_dirty) {
+  ez_sim_reset();
+  Switches panel(num);
+  add_panel(panel, num);
+  dirty_panel = &panel;
+  ez_sim_attach_pin_change(dirty_isr);
+  panel.scan_dirty_switches();  // initial states
+  uint32_t scans = 0;
+  uint32_t batch = 1000;
+  uint8_t  level = LOW;
+  bench_clock::time_point start = bench_clock::now();
+  double ns;
+  do {
+    for (uint32_t n = 0; n < batch; n++) {
+      if (one_dirty) {
+        level = !level;
+        ez_sim_set_pin(num / 2, level);
+      }
+      sink += panel.scan_dirty_switches();
+    }
+    scans += batch;
+    ns = elapsed_ns(start);
+  } while (ns < min_run_ms * 1e6);
+  ez_sim_attach_pin_change(NULL);
+  return ns / scans;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Debounce-to-report latency. The switch contact timeline, one level per
+// millisec, is given a bouncing edge (alternating levels for 'bounce_ms'
+// millisecs before settling) and the switch read every millisec of
+// virtual time until reported as switched. Returns the virtual time from
+// the final (settling) contact edge to the report.
+// For a button switch the press is held for 50 millisecs, the press
+// cycle being reported after the (bouncing) release.
+// With 'adaptive' the switch is under adaptive debounce (bounds 1 to
+// 'debounce') and the timeline is repeated, toggle switches alternating
+// on and off, so that the latency reported is that once adapted.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+#define timeline_ms 200
+
+static uint16_t bounce_edge(uint8_t *level, uint16_t at, uint8_t to, uint8_t bounce_ms) {
+  for (uint16_t ms = at; ms < timeline_ms; ms++) {
+    level[ms] = (ms - at < bounce_ms && (ms - at) % 2 == 1) ? !to : to;
+  }
+  return at + bounce_ms;  // time of settling edge
+}
+
+#define adaptive_runs 20
+
+static int32_t report_latency(uint8_t sw_type, uint8_t bounce_ms, uint16_t debounce,
+                              uint8_t engine = per_switch, bool adaptive = false) {
+  ez_sim_reset();
+  Switches panel(1);
+  panel.add_switch(sw_type, 2, circuit_C1);
+  panel.set_debounce(debounce);
+  if (engine != per_switch) panel.set_debounce_engine(engine);
+  if (adaptive) panel.set_adaptive_debounce(0, 1, debounce);
+  uint8_t  level[timeline_ms];
+  uint16_t settle_ms;
+  int32_t  latency = -1;  // never reported
+  for (uint8_t run = 0; run < (adaptive ? adaptive_runs : 1); run++) {
+    uint8_t from = (sw_type == toggle_switch && run % 2 == 1) ? HIGH : LOW;
+    memset(level, from, sizeof(level));
+    settle_ms = bounce_edge(level, 10, !from, bounce_ms);  // press, or toggle on/off
+    if (sw_type == button_switch) {
+      settle_ms = bounce_edge(level, 60, LOW, bounce_ms);  // release
+    }
+    latency = -1;
+    for (uint16_t ms = 0; ms < timeline_ms; ms++) {
+      ez_sim_set_pin(2, level[ms]);
+      bool sw_status = (engine == per_switch) ? panel.read_switch(0) : panel.read_all_switches() != 0;
+      if (sw_status == switched && latency < 0) latency = (int32_t)ms - settle_ms;
+      ez_sim_advance_ms(1);
+    }
+  }
+  return latency;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) min_run_ms = atoi(argv[1]);
+
+  printf("ez_switch_lib native benchmark\n\n");
+
+  printf("memory, this host\n");
+  printf("  switch control entry  %3u bytes\n", (unsigned)sizeof(Switches::switch_control));
+  printf("  per switch, 255       %5.1f bytes\n\n", Switches::storage_size(255) / 255.0);
+
+  printf("read_switch cost (64 switches)\n");
+  printf("  idle          %8.1f ns/call\n", time_scans(64, false) / 64);
+  printf("  in transition %8.1f ns/call\n", time_scans(64, true) / 64);
+
+  printf("\nfull read_switch scans\n");
+  static const uint8_t sizes[] = {8, 64, 255};
+  for (uint8_t s = 0; s < sizeof(sizes); s++) {
+    double ns = time_scans(sizes[s], false);
+    printf("  %3u switches  %12.0f scans/sec  %10.1f ns/scan\n", sizes[s], 1e9 / ns, ns);
+  }
+
+  printf("\nbatched read_all_switches scans, standard debounce\n");
+  for (uint8_t s = 0; s < sizeof(sizes); s++) {
+    double ns = time_scans(sizes[s], false, standard_debounce);
+    printf("  %3u switches  %12.0f scans/sec  %10.1f ns/scan\n", sizes[s], 1e9 / ns, ns);
+  }
+
+  printf("\nbatched read_all_switches scans, vertical debounce\n");
+  for (uint8_t s = 0; s < sizeof(sizes); s++) {
+    double ns = time_scans(sizes[s], false, vertical_debounce);
+    printf("  %3u switches  %12.0f scans/sec  %10.1f ns/scan\n", sizes[s], 1e9 / ns, ns);
+  }
+
+  printf("\nbatched read_all_switches scans, input bank\n");
+  double bank_ns = time_bank_scans();
+  printf("   64 switches  %12.0f scans/sec  %10.1f ns/scan\n", 1e9 / bank_ns, bank_ns);
+
+  printf("\ninterrupt driven scan_dirty_switches scans, 255 switches\n");
+  printf("  idle          %8.1f ns/scan\n", time_dirty_scans(255, false));
+  printf("  one dirty     %8.1f ns/scan\n", time_dirty_scans(255, true));
+
+  printf("\ndebounce-to-report latency (1 ms scan, 10 ms debounce, 4 ms bounce)\n");
+  printf("  toggle switch %4ld ms after settling\n", (long)report_latency(toggle_switch, 4, 10));
+  printf("  button switch %4ld ms after settling\n", (long)report_latency(button_switch, 4, 10));
+  printf("  toggle switch %4ld ms after settling, vertical debounce\n",
+         (long)report_latency(toggle_switch, 4, 10, vertical_debounce));
+  printf("  button switch %4ld ms after settling, vertical debounce\n",
+         (long)report_latency(button_switch, 4, 10, vertical_debounce));
+  printf("  toggle switch %4ld ms after settling, adaptive debounce\n",
+         (long)report_latency(toggle_switch, 4, 10, per_switch, true));
+  printf("  button switch %4ld ms after settling, adaptive debounce\n",
+         (long)report_latency(button_switch, 4, 10, per_switch, true));
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Arduino Switch Library - native trace replay.
+//
+// Replays a switch pin trace, as recorded on-device by Switch_trace and
+// drained to a file (see ez_switch_trace.h), through read_switch on the
+// simulated GPIO/virtual clock, and writes the resulting switch events
+// to stdout, one per line:
+//   <event time, millisecs> <tab> <switch_id> <tab> <event kind>
+// A summary (records, records lost on-device, events, replay time) is
+// written to stderr.
+//
+// The trace is decoded and replayed by replay_trace, see
+// ez_trace_replay.h - the virtual clock jumps straight to the next
+// transition whilst no switch is pending, so long traces replay in
+// seconds. Debounce periods may be overridden, for tuning.
+//
+// Usage: ez_switch_replay [-d debounce_millisecs] [-s scan_microsecs] [trace_file]
+//   -d   debounce period for all switches, default as recorded
+//   -s   scan period whilst switches are pending, default 1000
+//   the trace is read from stdin if no file is given
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "ez_switch_lib.h"
+#include "ez_trace_replay.h"
+
+static const char *event_names[] = {"", "toggle_on", "toggle_off", "button_cycle",
+                                    "button_press", "button_release"};
+
+static void print_event(const switch_event &event, void *context) {
+  printf("%u\t%u\t%s\n", event.event_time, event.switch_id, event_names[event.event_kind]);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t debounce = replay_as_recorded;
+  uint32_t scan_us  = 1000;
+  const char *file_name = NULL;
+  for (int arg = 1; arg < argc; arg++) {
+    if (strcmp(argv[arg], "-d") == 0 && arg + 1 < argc) {
+      debounce = strtoul(argv[++arg], NULL, 0);
+    } else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+      scan_us = strtoul(argv[++arg], NULL, 0);
+      if (scan_us == 0) scan_us = 1;
+    } else if (argv[arg][0] != '-' && file_name == NULL) {
+      file_name = argv[arg];
+    } else {
+      fprintf(stderr, "usage: ez_switch_replay [-d debounce_millisecs] [-s scan_microsecs] [trace_file]\n");
+      return 2;
+    }
+  }
+  FILE *in = file_name != NULL ? fopen(file_name, "rb") : stdin;
+  if (in == NULL) {
+    fprintf(stderr, "ez_switch_replay: cannot open %s\n", file_name);
+    return 1;
+  }
+  std::vector<uint8_t> trace;
+  uint8_t buffer[4096];
+  size_t  size;
+  while ((size = fread(buffer, 1, sizeof(buffer), in)) > 0) trace.insert(trace.end(), buffer, buffer + size);
+  if (in != stdin) fclose(in);
+
+  auto started = std::chrono::steady_clock::now();
+  replay_summary summary;
+  int result = replay_trace(trace.data(), trace.size(), debounce, scan_us, print_event, NULL, summary);
+  if (result == replay_not_trace) {
+    fprintf(stderr, "ez_switch_replay: not a version %d switch trace\n", trace_version);
+    return 1;
+  }
+  if (result == replay_no_header) {
+    fprintf(stderr, "ez_switch_replay: trace header incomplete\n");
+    return 1;
+  }
+  if (summary.truncated) fprintf(stderr, "ez_switch_replay: trace ends part way through a record\n");
+  double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  fprintf(stderr, "%u records, %llu lost on-device, %u events, %.1f secs of trace replayed in %.1f millisecs\n",
+          summary.records, (unsigned long long)summary.lost, summary.events,
+          (summary.end_us - summary.start_us) / 1e6, elapsed_ms);
+  return 0;
+}
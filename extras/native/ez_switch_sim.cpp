@@ -0,0 +1,281 @@
+// Arduino Switch Library - simulated GPIO and virtual clock for native builds.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <stdio.h>
+#include <atomic>
+#include "ez_switch_sim.h"
+
+volatile uint8_t ez_sim_port[ez_sim_num_ports];
+
+static uint8_t  sim_mode[ez_sim_num_pins];
+static std::atomic<uint64_t> sim_now_us(0);  // may be read by a scanner thread
+static void   (*sim_pin_change)(uint8_t pin) = NULL;
+
+static struct {
+  const uint8_t *row_pins;
+  const uint8_t *col_pins;
+  uint8_t  num_rows;
+  uint8_t  num_cols;
+  bool     diodes;
+  uint16_t pressed[16];   // per row, bit per column
+} sim_matrix;
+static bool sim_matrix_updating = false;
+
+static void sim_update_matrix();
+
+HardwareSerial Serial;
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Simulator control
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void ez_sim_reset() {
+  for (uint16_t port = 0; port < ez_sim_num_ports; port++) ez_sim_port[port] = 0;
+  memset(sim_mode, INPUT, sizeof(sim_mode));
+  sim_now_us = 0;
+  sim_pin_change = NULL;
+  sim_matrix.num_rows = 0;
+}
+
+void ez_sim_set_pin(uint8_t pin, uint8_t level) {
+  uint8_t mask = digitalPinToBitMask(pin);
+  uint8_t was  = ez_sim_get_pin(pin);
+  // atomic, as pins may be set by the test and a scanner thread at once
+  if (level == LOW) __atomic_fetch_and(&ez_sim_port[digitalPinToPort(pin)], (uint8_t)~mask, __ATOMIC_SEQ_CST);
+  else              __atomic_fetch_or(&ez_sim_port[digitalPinToPort(pin)], mask, __ATOMIC_SEQ_CST);
+  if (sim_pin_change != NULL && sim_mode[pin] != OUTPUT && was != ez_sim_get_pin(pin)) {
+    sim_pin_change(pin);  // simulated pin change interrupt
+  }
+  sim_update_matrix();
+}
+
+void ez_sim_attach_pin_change(void (*handler)(uint8_t pin)) {
+  sim_pin_change = handler;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Simulated matrix keypad
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void ez_sim_attach_matrix(const uint8_t row_pins[], uint8_t num_rows,
+                          const uint8_t col_pins[], uint8_t num_cols, bool diodes) {
+  sim_matrix.row_pins = row_pins;
+  sim_matrix.col_pins = col_pins;
+  sim_matrix.num_rows = num_rows;
+  sim_matrix.num_cols = num_cols;
+  sim_matrix.diodes   = diodes;
+  memset(sim_matrix.pressed, 0, sizeof(sim_matrix.pressed));
+  sim_update_matrix();
+}
+
+void ez_sim_set_key(uint8_t row, uint8_t col, bool pressed) {
+  if (pressed) sim_matrix.pressed[row] |= (uint16_t)1 << col;
+  else         sim_matrix.pressed[row] &= ~((uint16_t)1 << col);
+  sim_update_matrix();
+}
+
+// Recompute the row levels from the driven columns and pressed keys.
+static void sim_update_matrix() {
+  if (sim_matrix.num_rows == 0 || sim_matrix_updating) return;
+  sim_matrix_updating = true;
+  uint16_t driven = 0;  // columns driven LOW
+  for (uint8_t col = 0; col < sim_matrix.num_cols; col++) {
+    uint8_t pin = sim_matrix.col_pins[col];
+    if (sim_mode[pin] == OUTPUT && ez_sim_get_pin(pin) == LOW) driven |= (uint16_t)1 << col;
+  }
+  uint16_t low_rows = 0;
+  uint16_t reached  = driven;  // columns at LOW
+  bool     spread   = true;
+  while (spread) {
+    spread = false;
+    for (uint8_t row = 0; row < sim_matrix.num_rows; row++) {
+      if ((low_rows >> row) & 1 || (sim_matrix.pressed[row] & reached) == 0) continue;
+      low_rows |= (uint16_t)1 << row;
+      if (!sim_matrix.diodes && (sim_matrix.pressed[row] & ~reached) != 0) {
+        reached |= sim_matrix.pressed[row];  // no diodes, LOW spreads back along the row
+        spread = true;
+      }
+    }
+  }
+  for (uint8_t row = 0; row < sim_matrix.num_rows; row++) {
+    uint8_t pin = sim_matrix.row_pins[row];
+    if ((low_rows >> row) & 1) ez_sim_set_pin(pin, LOW);
+    else ez_sim_set_pin(pin, sim_mode[pin] == INPUT_PULLUP ? HIGH : LOW);
+  }
+  sim_matrix_updating = false;
+}
+
+uint8_t ez_sim_get_pin(uint8_t pin) {
+  return (ez_sim_port[digitalPinToPort(pin)] & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+uint8_t ez_sim_pin_mode(uint8_t pin) {
+  return sim_mode[pin];
+}
+
+void ez_sim_advance_ms(uint32_t ms) {
+  sim_now_us += (uint64_t)ms * 1000;
+}
+
+void ez_sim_advance_us(uint32_t us) {
+  sim_now_us += us;
+}
+
+void ez_sim_set_time_us(uint64_t us) {
+  sim_now_us = us;
+}
+
+uint64_t ez_sim_now_us() {
+  return sim_now_us;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Arduino core functions, serviced by the simulator
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int digitalRead(uint8_t pin) {
+  return ez_sim_get_pin(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  ez_sim_set_pin(pin, level);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  sim_mode[pin] = mode;
+  if (mode != OUTPUT) ez_sim_set_pin(pin, mode == INPUT_PULLUP ? HIGH : LOW);
+  sim_update_matrix();
+}
+
+uint32_t millis() {
+  return (uint32_t)(sim_now_us / 1000);
+}
+
+uint32_t micros() {
+  return (uint32_t)sim_now_us;
+}
+
+void delay(uint32_t ms) {
+  ez_sim_advance_ms(ms);
+}
+
+void noInterrupts() {}
+void interrupts()   {}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Simulator backend, for use with Switches::set_io
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static uint8_t sim_read_pin(uint8_t pin) {
+  return ez_sim_get_pin(pin);
+}
+
+static void sim_write_pin(uint8_t pin, uint8_t level) {
+  ez_sim_set_pin(pin, level);
+}
+
+static void sim_set_pin_mode(uint8_t pin, uint8_t mode) {
+  pinMode(pin, mode);
+}
+
+static uint32_t sim_read_clock() {
+  return millis();
+}
+
+static uint32_t sim_read_clock_us() {
+  return micros();
+}
+
+static uint8_t sim_pin_port(uint8_t pin) {
+  return digitalPinToPort(pin);
+}
+
+static uint8_t sim_pin_bit(uint8_t pin) {
+  return pin & 7;
+}
+
+static uint32_t sim_read_port(uint8_t port) {
+  return ez_sim_port[port];
+}
+
+static void sim_write_port(uint8_t port, uint32_t set_mask, uint32_t clear_mask) {
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    if ((clear_mask >> bit) & 1) ez_sim_set_pin(port * 8 + bit, LOW);
+    if ((set_mask >> bit) & 1)   ez_sim_set_pin(port * 8 + bit, HIGH);
+  }
+}
+
+const ez_io_backend ez_sim_io = {
+  sim_read_pin,
+  sim_write_pin,
+  sim_set_pin_mode,
+  sim_read_clock,
+  sim_pin_port,
+  sim_pin_bit,
+  sim_read_port,
+  sim_write_port,
+  sim_read_clock_us
+};
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Serial/Print support
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(const char *s) {
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return print(str);
+}
+
+size_t Print::print(long n, int base) {
+  if (base == 10 && n < 0) return print('-') + print((unsigned long)-n, 10);
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return print(buf);
+}
+
+size_t Print::println() {
+  return write('\r') + write('\n');
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
@@ -0,0 +1,54 @@
+// Arduino Switch Library - simulated GPIO and virtual clock for native builds.
+//
+// The simulator holds the level of 256 pins, grouped into 32 eight bit
+// ports, and a virtual clock in microseconds that only moves when told
+// to (or via delay). The Arduino core functions declared in the native
+// Arduino.h are serviced from here, so ez_switch_lib and its default
+// 'ez_arduino_io' backend run unchanged against the simulated hardware.
+//
+// Input pins idle at the level given by their pinMode - HIGH for
+// INPUT_PULLUP, LOW otherwise - so set any switch levels AFTER the
+// associated switches have been added.
+//
+// Pins and the clock may be driven by the test whilst a scanner thread
+// (see ez_switch_scanner.h) reads them.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_switch_sim_h
+#define ez_switch_sim_h
+#include <Arduino.h>
+#include "ez_switch_io.h"
+
+void     ez_sim_reset     ();                            // all pins LOW, clock to zero
+void     ez_sim_set_pin   (uint8_t pin, uint8_t level);  // external drive of a pin, eg a switch contact
+uint8_t  ez_sim_get_pin   (uint8_t pin);                 // current level of a pin, eg a linked output
+uint8_t  ez_sim_pin_mode  (uint8_t pin);                 // last mode set for a pin
+void     ez_sim_advance_ms(uint32_t ms);                 // move the virtual clock on
+void     ez_sim_advance_us(uint32_t us);
+void     ez_sim_set_time_us(uint64_t us);
+uint64_t ez_sim_now_us    ();
+
+// Simulated pin change interrupt source. Once attached, the handler is
+// called, as if from an ISR, whenever an input pin's level changes.
+// A NULL handler detaches.
+void     ez_sim_attach_pin_change(void (*handler)(uint8_t pin));
+
+// Simulated matrix keypad. Once attached, each row pin reads LOW whilst
+// it is connected to a column pin driven LOW (OUTPUT, LOW) through
+// pressed keys - directly if the keys have diodes, otherwise via any
+// path of pressed keys, so giving the ghosting of a real matrix. Row
+// pins are otherwise at the level given by their pinMode.
+void     ez_sim_attach_matrix(const uint8_t row_pins[], uint8_t num_rows,
+                              const uint8_t col_pins[], uint8_t num_cols, bool diodes);
+void     ez_sim_set_key      (uint8_t row, uint8_t col, bool pressed);
+
+// A backend equivalent to 'ez_arduino_io' but bound directly to the
+// simulator, for use with Switches::set_io.
+extern const ez_io_backend ez_sim_io;
+
+#endif
@@ -0,0 +1,1235 @@
+// Arduino Switch Library - native behaviour checks.
+//
+// Runs ez_switch_lib against the simulated GPIO/virtual clock and
+// checks its behaviour, each failed check being reported with its line.
+// The exit status is nonzero if any check fails, eg
+//   make test
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "ez_switch_lib.h"
+#include "ez_switch_sim.h"
+#include "ez_mock_bank.h"
+#include "ez_switch_scanner.h"
+#include "ez_trace_replay.h"
+
+static uint32_t num_checks   = 0;
+static uint32_t num_failures = 0;
+
+#define expect(condition) expect_at((condition), #condition, __LINE__)
+
+static void expect_at(bool passed, const char *condition, int line) {
+  num_checks++;
+  if (passed) return;
+  num_failures++;
+  fprintf(stderr, "ez_switch_test.cpp:%d: check failed: %s\n", line, condition);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Move the virtual clock on 'ms' millisecs, a read_all_switches scan
+// each millisec, returning the number of switches reported switched.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static uint32_t scan_for(Switches &panel, uint32_t ms) {
+  uint32_t num_switched = 0;
+  for (uint32_t step = 0; step < ms; step++) {
+    ez_sim_advance_ms(1);
+    uint32_t switched_mask[ez_switch_words(255)];
+    num_switched += panel.read_all_switches(switched_mask);
+  }
+  return num_switched;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// A Print stream collecting the bytes written to it, eg by the trace
+// and metrics writers, and a reader of its little endian values.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+class Byte_sink : public Print
+{
+  public:
+    size_t write(uint8_t c) { if (size < sizeof(bytes)) bytes[size++] = c; return 1; }
+    uint32_t get_le(size_t at, uint8_t width) const {
+      uint32_t value = 0;
+      for (uint8_t b = width; b > 0; b--) value = (value << 8) | bytes[at + b - 1];
+      return value;
+    }
+    uint8_t bytes[256];
+    size_t  size = 0;
+};
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Vertical debounce engine: a change reported on the 4th agreeing
+// sample, samples (debounce + 2) / 3 millisecs apart, a bounce shorter
+// than the 4 samples rejected, toggle and button events at the flip,
+// and per switch periods ignored.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_vertical() {
+  ez_sim_reset();
+  Switches panel(3);
+  switch_event events[8];
+  switch_event event;
+  panel.switch_events.begin(events, 8);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  panel.add_switch(button_switch, 3, circuit_C1);
+  panel.add_switch(button_switch, 4, circuit_C1);
+  expect(panel.set_button_mode(2, button_press_mode) == mode_success);
+  panel.set_debounce_engine(vertical_debounce);  // samples every 4 ms, at 4, 8, 12...
+
+  // changed at 2, sampled at 4, 8, 12 and 16, so flipped at 16
+  scan_for(panel, 2);
+  ez_sim_set_pin(2, HIGH);
+  ez_sim_set_pin(3, HIGH);
+  ez_sim_set_pin(4, HIGH);
+  expect(scan_for(panel, 13) == 0);
+  expect(panel.states() == 0 && panel.pending() == 0);
+  expect(scan_for(panel, 1) == 2);
+  expect(panel.states() == 0x01 && panel.pending() == 0x06);
+  expect(panel.switch_events.available() == 2);
+  expect(panel.switch_events.pop(event) && event.switch_id == 0 && event.event_kind == toggle_on_event);
+  expect(event.event_time == 16);
+  expect(panel.switch_events.pop(event) && event.switch_id == 2 && event.event_kind == button_press_event);
+  expect(event.event_time == 16);
+
+  // low for 3 samples only, at 20, 24 and 28, so rejected
+  ez_sim_set_pin(2, LOW);
+  scan_for(panel, 13);
+  ez_sim_set_pin(2, HIGH);
+  expect(scan_for(panel, 21) == 0);
+  expect(panel.states() == 0x01);
+
+  // buttons released at 50, flipped at 64, the cycle completing then
+  // and the press mode release not reported
+  ez_sim_set_pin(3, LOW);
+  ez_sim_set_pin(4, LOW);
+  expect(scan_for(panel, 13) == 0);
+  expect(panel.pending() == 0x06);
+  expect(scan_for(panel, 1) == 1);
+  expect(panel.pending() == 0);
+  expect(panel.switch_events.available() == 1);
+  expect(panel.switch_events.pop(event) && event.switch_id == 1 && event.event_kind == button_cycle_event);
+  expect(event.event_time == 64);
+
+  // 20 ms, so samples (20 + 2) / 3 = 7 ms apart, at 71, 78, 85 and 92,
+  // the per switch period being ignored
+  panel.set_debounce(20);
+  panel.set_debounce(0, 100);
+  ez_sim_set_pin(2, LOW);
+  expect(scan_for(panel, 27) == 0);
+  expect(scan_for(panel, 1) == 1);
+  expect(panel.switch_events.pop(event) && event.switch_id == 0 && event.event_kind == toggle_off_event);
+  expect(event.event_time == 92);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Read a Fixed_switch each millisec for 'ms' millisecs, returning the
+// number of times it was reported switched.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+template <typename F>
+static uint32_t read_fixed_for(F &fixed, uint32_t ms) {
+  uint32_t num_switched = 0;
+  for (uint32_t step = 0; step < ms; step++) {
+    ez_sim_advance_ms(1);
+    if (fixed.read_switch() == switched) num_switched++;
+  }
+  return num_switched;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Compile time switches: Static_switches<N> filling and rejecting, a
+// snapshot of one of its switches, and Fixed_switch toggle and button
+// debounce against the simulator.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_static() {
+  ez_sim_reset();
+  Static_switches<2> panel;
+  expect(panel.add_switch(toggle_switch, 2, circuit_C1) == 0);
+  expect(panel.add_switch(button_switch, 3, circuit_C2) == 1);
+  expect(panel.add_switch(toggle_switch, 4, circuit_C1) == add_failure);  // table full
+  expect(panel.num_free_switch_slots() == 0);
+  scan_for(panel, 5);
+  ez_sim_set_pin(2, HIGH);
+  ez_sim_set_pin(3, LOW);  // pressed, circuit_C2
+  expect(scan_for(panel, 20) == 1);
+  Switches::switch_control copy;
+  expect(panel.snapshot(0, copy));
+  expect(copy.switch_type == toggle_switch && copy.switch_pin == 2 && copy.switch_status == on);
+  expect(panel.snapshot(1, copy));
+  expect(copy.switch_type == button_switch && copy.switch_pending);
+  ez_sim_set_pin(3, HIGH);
+  expect(scan_for(panel, 20) == 1);
+  expect(panel.snapshot(1, copy) && !copy.switch_pending);
+
+  // a bouncing toggle, one event once settled for the debounce period
+  Fixed_switch<toggle_switch, 5, circuit_C1> toggle;
+  toggle.begin();
+  expect(read_fixed_for(toggle, 5) == 0);
+  for (uint8_t edge = 0; edge < 5; edge++) {
+    ez_sim_set_pin(5, (edge & 1) ? LOW : HIGH);
+    expect(read_fixed_for(toggle, 1) == 0);
+  }
+  ez_sim_set_pin(5, HIGH);
+  expect(read_fixed_for(toggle, 30) == 1);
+  expect(toggle.switch_status == on && !toggle.switch_pending);
+  ez_sim_set_pin(5, LOW);
+  expect(read_fixed_for(toggle, 30) == 1);
+  expect(toggle.switch_status == !on);
+
+  // a button, one cycle once released for the debounce period
+  Fixed_switch<button_switch, 6, circuit_C2, 20> button;
+  button.begin();
+  expect(read_fixed_for(button, 5) == 0);
+  ez_sim_set_pin(6, LOW);
+  expect(read_fixed_for(button, 50) == 0);
+  expect(button.switch_pending);
+  ez_sim_set_pin(6, HIGH);
+  expect(read_fixed_for(button, 19) == 0);
+  expect(read_fixed_for(button, 1) == 1);
+  expect(!button.switch_pending);
+  expect(read_fixed_for(button, 50) == 0);
+
+  // press and release each reported at once, in press_release mode
+  Fixed_switch<button_switch, 7, circuit_C1, 10, button_press_release_mode> edges;
+  edges.begin();
+  ez_sim_set_pin(7, HIGH);
+  expect(read_fixed_for(edges, 1) == 1);
+  expect(read_fixed_for(edges, 20) == 0);
+  ez_sim_set_pin(7, LOW);
+  expect(read_fixed_for(edges, 1) == 1);
+  expect(!edges.button_is_pressed());
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Event queue: capacity checks, FIFO order, overflow counting, and the
+// free running indices wrapping.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_event_queue() {
+  switch_event buffer[4];
+  switch_event event;
+  Switch_event_queue queue;
+  expect(!queue.is_enabled());
+  expect(!queue.push(1, toggle_on_event, 0));  // not established
+  expect(queue.begin(buffer, 3) == queue_failure);
+  expect(queue.begin(buffer, 1) == queue_failure);
+  expect(queue.begin(NULL, 4) == queue_failure);
+  expect(queue.begin(buffer, 4) == queue_success);
+
+  for (uint8_t n = 0; n < 4; n++) expect(queue.push(n, toggle_on_event, 100 + n));
+  expect(!queue.push(9, toggle_off_event, 200));
+  expect(queue.overflows == 1);
+  expect(queue.available() == 4);
+  for (uint8_t n = 0; n < 4; n++) {
+    expect(queue.pop(event));
+    expect(event.switch_id == n && event.event_time == 100u + n);
+  }
+  expect(!queue.pop(event));
+
+  // 600 events through the 4 entry queue, over two wraps of the indices
+  bool in_order = true;
+  for (uint16_t n = 0; n < 600; n++) {
+    queue.push(n & 0xFF, (n % 5) + 1, n);
+    if (n % 3 == 2) {
+      switch_event batch[4];
+      uint8_t count = queue.pop_events(batch, 4);
+      for (uint8_t b = 0; b < count; b++) {
+        if (batch[b].event_time != (uint32_t)(n + 1 - count + b)) in_order = false;
+      }
+    }
+  }
+  expect(in_order);
+  expect(queue.overflows == 1);
+
+  // filled by the read functions
+  ez_sim_reset();
+  Switches panel(2);
+  switch_event events[8];
+  expect(panel.switch_events.begin(events, 8) == queue_success);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  panel.add_switch(button_switch, 3, circuit_C1);
+  scan_for(panel, 5);
+  ez_sim_set_pin(2, HIGH);
+  ez_sim_set_pin(3, HIGH);
+  scan_for(panel, 20);
+  ez_sim_set_pin(3, LOW);
+  scan_for(panel, 20);
+  expect(panel.switch_events.available() == 2);
+  expect(panel.switch_events.pop(event) && event.switch_id == 0 && event.event_kind == toggle_on_event);
+  expect(event.event_time == 16);  // change seen at 6, then the 10 ms debounce period
+  expect(panel.switch_events.pop(event) && event.switch_id == 1 && event.event_kind == button_cycle_event);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Interrupt driven scanning: dirty switches, the debounce deadline heap
+// and next_deadline, across the millis() roll over. The switches are
+// only scanned when next_deadline says so, as a sleeping sketch would.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static Switches *dirty_panel = NULL;
+
+static void pin_changed(uint8_t pin) {
+  dirty_panel->mark_pin_dirty(pin);  // as a pin change ISR
+}
+
+static void check_dirty_scanning() {
+  const uint8_t num_switches = 40;
+  ez_sim_reset();
+  ez_sim_set_time_us(((1ULL << 32) - 100) * 1000);  // millis() rolls over 100 ms in
+  Switches panel(num_switches);
+  dirty_panel = &panel;
+  for (uint8_t sw = 0; sw < num_switches; sw++) {
+    panel.add_switch(toggle_switch, sw + 2, circuit_C1);
+    panel.set_debounce(sw, 10 + (sw * 7) % num_switches * 5);  // 10 to 205 ms, all different
+  }
+  ez_sim_attach_pin_change(pin_changed);
+  uint32_t switched_mask[ez_switch_words(num_switches)];
+  expect(!panel.switches_idle());  // all dirty when added
+  expect(panel.next_deadline() == 0);
+  expect(panel.scan_dirty_switches(switched_mask) == 0);
+  expect(panel.switches_idle());
+  expect(panel.next_deadline() == no_deadline);
+
+  // all switched at once, then each reported once its own debounce
+  // period has passed, in order of period
+  for (uint8_t sw = 0; sw < num_switches; sw++) ez_sim_set_pin(sw + 2, HIGH);
+  expect(panel.next_deadline() == 0);
+  expect(panel.scan_dirty_switches(switched_mask) == 0);
+  uint32_t start = millis();
+  uint32_t scans = 0, reported = 0, last_period = 0;
+  bool in_time = true, in_order = true;
+  while (panel.next_deadline() != no_deadline && scans < 1000) {
+    ez_sim_advance_ms(panel.next_deadline());
+    scans++;
+    if (panel.scan_dirty_switches(switched_mask) == 0) continue;
+    for (uint8_t sw = 0; sw < num_switches; sw++) {
+      if (((switched_mask[sw / 32] >> (sw % 32)) & 1) == 0) continue;
+      reported++;
+      uint32_t period = 10 + (sw * 7) % num_switches * 5;
+      if (millis() - start != period) in_time = false;
+      if (period < last_period) in_order = false;
+      last_period = period;
+    }
+  }
+  expect(reported == num_switches);
+  expect(scans == num_switches);  // one scan per deadline, none wasted
+  expect(in_time && in_order);
+  expect((int32_t)millis() > 0);  // over the roll over
+  expect(panel.switches_idle());
+
+  // a toggle switch moving back part way through its debounce period is
+  // still reported at the deadline, then marked dirty, as its status no
+  // longer matches its contact, and so reported back again
+  ez_sim_set_pin(2, LOW);
+  panel.scan_dirty_switches(switched_mask);
+  ez_sim_advance_ms(3);
+  ez_sim_set_pin(2, HIGH);
+  expect(panel.scan_dirty_switches(switched_mask) == 0);
+  expect(panel.next_deadline() == 7);
+  ez_sim_advance_ms(7);
+  expect(panel.scan_dirty_switches(switched_mask) == 1 && panel.switches[0].switch_status != on);
+  expect(panel.next_deadline() == 0);
+  expect(panel.scan_dirty_switches(switched_mask) == 0);
+  expect(panel.next_deadline() == 10);
+  ez_sim_advance_ms(10);
+  expect(panel.scan_dirty_switches(switched_mask) == 1 && panel.switches[0].switch_status == on);
+  expect(panel.switches_idle());
+  ez_sim_attach_pin_change(NULL);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Debounce periods: the global period changes only switches still at
+// the previous global period, leaving per switch and adaptive periods,
+// and applies to switches added later.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_set_debounce() {
+  ez_sim_reset();
+  Switches panel(4);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  panel.add_switch(toggle_switch, 3, circuit_C1);
+  panel.add_switch(toggle_switch, 4, circuit_C1);
+  panel.set_debounce(1, 40);
+  expect(panel.set_adaptive_debounce(2, 5, 30) == adaptive_success);
+  uint16_t adaptive_period = panel.switches[2].switch_debounce;
+  panel.set_debounce(25);
+  expect(panel.switches[0].switch_debounce == 25);
+  expect(panel.switches[1].switch_debounce == 40);
+  expect(panel.switches[2].switch_debounce == adaptive_period);
+  panel.add_switch(toggle_switch, 5, circuit_C1);
+  expect(panel.switches[3].switch_debounce == 25);
+  panel.set_debounce(1, 25);  // back at the global period, so follows it
+  panel.set_debounce(15);
+  expect(panel.switches[0].switch_debounce == 15 && panel.switches[1].switch_debounce == 15);
+  expect(panel.switches[2].switch_debounce == adaptive_period);
+
+  // the period taken is the one reported
+  scan_for(panel, 5);
+  ez_sim_set_pin(2, HIGH);
+  expect(scan_for(panel, 15) == 0);
+  expect(scan_for(panel, 1) == 1);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Leading edge button modes: a press (and release) reported at its
+// first edge, bounces ignored for the lockout, and an edge arriving
+// during the lockout taken once it ends.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void bounce_pin(Switches &panel, uint8_t pin, uint8_t level, uint8_t bounces) {
+  for (uint8_t edge = 0; edge < bounces; edge++) {
+    ez_sim_set_pin(pin, (edge & 1) ? !level : level);
+    scan_for(panel, 1);
+  }
+  ez_sim_set_pin(pin, level);
+}
+
+static void check_leading_edge() {
+  ez_sim_reset();
+  Switches panel(3);
+  switch_event events[16];
+  switch_event event;
+  panel.switch_events.begin(events, 16);
+  panel.add_switch(button_switch, 2, circuit_C1);
+  panel.add_switch(button_switch, 3, circuit_C1);
+  panel.add_switch(toggle_switch, 4, circuit_C1);
+  expect(panel.set_button_mode(2, button_press_mode) == mode_failure);  // toggle switch
+  expect(panel.set_button_mode(0, 7) == mode_failure);
+  expect(panel.set_button_mode(0, button_press_mode) == mode_success);
+  expect(panel.set_button_mode(1, button_press_release_mode) == mode_success);
+  scan_for(panel, 20);
+
+  // press, bouncing for 5 ms, reported at the first edge only
+  uint32_t pressed = millis() + 1;
+  bounce_pin(panel, 2, HIGH, 5);
+  bounce_pin(panel, 3, HIGH, 5);
+  scan_for(panel, 30);
+  expect(panel.switch_events.available() == 2);
+  expect(panel.switch_events.pop(event) && event.switch_id == 0 && event.event_kind == button_press_event);
+  expect(event.event_time == pressed);
+  expect(panel.switch_events.pop(event) && event.switch_id == 1 && event.event_kind == button_press_event);
+  expect(event.event_time == pressed + 5);  // after the 5 ms of switch 0's bounces
+
+  // release, bouncing, reported for press_release mode only
+  uint32_t released = millis() + 1;
+  bounce_pin(panel, 2, LOW, 5);
+  bounce_pin(panel, 3, LOW, 5);
+  scan_for(panel, 30);
+  expect(panel.switch_events.available() == 1);
+  expect(panel.switch_events.pop(event) && event.switch_id == 1 && event.event_kind == button_release_event);
+  expect(event.event_time == released + 5);
+
+  // a release 4 ms into the 10 ms lockout is taken as it ends
+  pressed = millis() + 1;
+  ez_sim_set_pin(3, HIGH);
+  scan_for(panel, 4);
+  ez_sim_set_pin(3, LOW);
+  scan_for(panel, 20);
+  expect(panel.switch_events.available() == 2);
+  expect(panel.switch_events.pop(event) && event.event_kind == button_press_event && event.event_time == pressed);
+  expect(panel.switch_events.pop(event) && event.event_kind == button_release_event);
+  expect(event.event_time == pressed + 10);
+  expect(!panel.button_is_pressed(1));
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Switch times: debounce periods and the deadline heap across the 16 bit
+// switch time roll over (65535 to 0 millisecs), which, built with
+// ez_switch_short_time, is where ez_time_t wraps, plus snapshot.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_time_wrap() {
+  ez_sim_reset();
+  ez_sim_set_time_us(65500ULL * 1000);
+  Switches panel(4);
+  switch_event events[8];
+  switch_event event;
+  panel.switch_events.begin(events, 8);
+  dirty_panel = &panel;
+  for (uint8_t sw = 0; sw < 3; sw++) {
+    panel.add_switch(toggle_switch, sw + 2, circuit_C1);
+    panel.set_debounce(sw, 80 >> sw);  // 80, 40 and 20 ms, so the latest deadline first in
+  }
+  panel.add_switch(button_switch, 5, circuit_C1);
+  ez_sim_attach_pin_change(pin_changed);
+  uint32_t switched_mask[1];
+  panel.scan_dirty_switches(switched_mask);
+
+  // changed at 65510, reported at 65530, 65550 and 65590, the last two
+  // after the roll over, so in reverse order of switch_id
+  ez_sim_advance_ms(10);
+  for (uint8_t sw = 0; sw < 3; sw++) ez_sim_set_pin(sw + 2, HIGH);
+  expect(panel.scan_dirty_switches(switched_mask) == 0);
+  const uint32_t waits[3] = {20, 20, 40};
+  for (uint8_t sw = 0; sw < 3; sw++) {
+    expect(panel.next_deadline() == waits[sw]);
+    ez_sim_advance_ms(waits[sw] - 1);
+    expect(panel.scan_dirty_switches(switched_mask) == 0);
+    ez_sim_advance_ms(1);
+    expect(panel.scan_dirty_switches(switched_mask) == 1 && switched_mask[0] == 1u << (2 - sw));
+  }
+  expect(panel.next_deadline() == no_deadline);
+  const uint32_t times[3] = {65530, 65550, 65590};
+  for (uint8_t sw = 0; sw < 3; sw++) {
+    expect(panel.switch_events.pop(event) && event.switch_id == 2 - sw && event.event_time == times[sw]);
+  }
+  ez_sim_attach_pin_change(NULL);
+
+  // a button pressed before the roll over, released after it, read
+  // by read_all_switches
+  ez_sim_set_time_us(65520ULL * 1000);
+  ez_sim_set_pin(5, HIGH);
+  expect(scan_for(panel, 30) == 0);
+  ez_sim_set_pin(5, LOW);
+  expect(scan_for(panel, 9) == 0);
+  expect(scan_for(panel, 1) == 1);
+  expect(panel.switch_events.pop(event) && event.switch_id == 3 && event.event_kind == button_cycle_event);
+  expect(event.event_time == 65560);
+
+  // snapshot, a copy of a switch, but none of a removed or unknown one
+  Switches::switch_control copy;
+  expect(panel.snapshot(0, copy));
+  expect(memcmp(&copy, &panel.switches[0], sizeof(copy)) == 0);
+  expect(copy.switch_status == on && copy.switch_debounce == 80);
+  expect(panel.remove_switch(0) == remove_success);
+  expect(!panel.snapshot(0, copy));
+  expect(!panel.snapshot(4, copy));
+  expect(!panel.snapshot(none_switched, copy));
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Handler dispatch by poll: a switch's own handler for the event kinds
+// it takes, otherwise the handler for the event kind, with contexts.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+struct handler_calls {
+  uint8_t  count;
+  uint8_t  switch_id;
+  uint8_t  event_kind;
+};
+
+static void record_call(uint8_t switch_id, uint8_t event_kind, void *context) {
+  handler_calls *calls = (handler_calls *)context;
+  calls->count++;
+  calls->switch_id  = switch_id;
+  calls->event_kind = event_kind;
+}
+
+static uint8_t poll_for(Switches &panel, uint32_t ms) {
+  uint8_t num_switched = 0;
+  for (uint32_t step = 0; step < ms; step++) {
+    ez_sim_advance_ms(1);
+    num_switched += panel.poll();
+  }
+  return num_switched;
+}
+
+static void check_handlers() {
+  ez_sim_reset();
+  Switches panel(3);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  panel.add_switch(toggle_switch, 3, circuit_C1);
+  panel.add_switch(button_switch, 4, circuit_C1);
+  handler_calls own = {}, toggled_off = {}, cycled = {};
+  expect(panel.set_switch_handler(3, record_call) == handler_failure);  // no such switch
+  expect(panel.set_event_handler(0, record_call) == handler_failure);   // no such event kind
+  expect(panel.set_switch_handler(0, record_call, &own, ez_event_mask(toggle_on_event)) == handler_success);
+  expect(panel.set_event_handler(toggle_off_event, record_call, &toggled_off) == handler_success);
+  expect(panel.set_event_handler(button_cycle_event, record_call, &cycled) == handler_success);
+  poll_for(panel, 5);
+
+  // switch 0 on - its own handler; switch 1 on - no handler
+  ez_sim_set_pin(2, HIGH);
+  ez_sim_set_pin(3, HIGH);
+  expect(poll_for(panel, 20) == 2);
+  expect(own.count == 1 && own.switch_id == 0 && own.event_kind == toggle_on_event);
+  expect(toggled_off.count == 0);
+  // both off - switch 0's own handler does not take toggle_off_event
+  ez_sim_set_pin(2, LOW);
+  ez_sim_set_pin(3, LOW);
+  expect(poll_for(panel, 20) == 2);
+  expect(own.count == 1);
+  expect(toggled_off.count == 2 && toggled_off.event_kind == toggle_off_event);
+  // button cycle, to the event kind's handler
+  ez_sim_set_pin(4, HIGH);
+  poll_for(panel, 20);
+  ez_sim_set_pin(4, LOW);
+  expect(poll_for(panel, 20) == 1);
+  expect(cycled.count == 1 && cycled.switch_id == 2 && cycled.event_kind == button_cycle_event);
+  // handler removed
+  expect(panel.set_switch_handler(0, NULL) == handler_success);
+  ez_sim_set_pin(2, HIGH);
+  poll_for(panel, 20);
+  expect(own.count == 1);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Output links: validation, each action and polarity, outputs changed
+// together written in one port write, and pulses ending (and being
+// restarted) on time. Writes are counted by a backend wrapping the
+// simulator's.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static uint32_t pin_writes  = 0;
+static uint32_t port_writes = 0;
+
+static void counted_write_pin(uint8_t pin, uint8_t level) {
+  pin_writes++;
+  ez_sim_io.write_pin(pin, level);
+}
+
+static void counted_write_port(uint8_t port, uint32_t set_mask, uint32_t clear_mask) {
+  port_writes++;
+  ez_sim_io.write_port(port, set_mask, clear_mask);
+}
+
+static void check_output_links() {
+  ez_io_backend counting_io = ez_sim_io;
+  counting_io.write_pin  = counted_write_pin;
+  counting_io.write_port = counted_write_port;
+  ez_sim_reset();
+  Switches panel(1);
+  panel.set_io(&counting_io);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  expect(panel.add_output_link(0, 40, link_toggle) == link_failure);  // no link storage
+  Switches::output_link links[4];
+  expect(panel.set_output_links(links, 4) == link_success);
+  expect(panel.add_output_link(1, 40, link_toggle) == link_failure);  // no such switch
+  expect(panel.add_output_link(0, 40, 3) == link_failure);
+  expect(panel.add_output_link(0, 40, link_pulse, HIGH, 0) == link_failure);
+  expect(panel.add_output_link(0, 40, link_toggle) == 0);
+  expect(panel.add_output_link(0, 41, link_follow, LOW) == 1);
+  expect(panel.add_output_link(0, 42, link_pulse, HIGH, 30) == 2);
+  expect(panel.add_output_link(0, 43, link_follow) == 3);
+  expect(panel.add_output_link(0, 44, link_toggle) == link_failure);  // storage full
+  expect(ez_sim_get_pin(40) == LOW && ez_sim_get_pin(41) == HIGH && ez_sim_get_pin(42) == LOW);
+  scan_for(panel, 5);
+
+  // on - all four outputs, on the one port, in a single write
+  pin_writes = port_writes = 0;
+  ez_sim_set_pin(2, HIGH);
+  scan_for(panel, 11);  // seen, then the 10 ms debounce period
+  expect(ez_sim_get_pin(40) == HIGH && ez_sim_get_pin(41) == LOW);
+  expect(ez_sim_get_pin(42) == HIGH && ez_sim_get_pin(43) == HIGH);
+  expect(port_writes == 1 && pin_writes == 0);
+  // the pulse ends 30 ms after the switch
+  scan_for(panel, 29);
+  expect(ez_sim_get_pin(42) == HIGH);
+  scan_for(panel, 1);
+  expect(ez_sim_get_pin(42) == LOW);
+  expect(port_writes == 2);
+
+  // off - toggled and followed, pulsed again, and restarted by on
+  ez_sim_set_pin(2, LOW);
+  scan_for(panel, 11);  // seen, then the 10 ms debounce period
+  expect(ez_sim_get_pin(40) == LOW && ez_sim_get_pin(41) == HIGH);
+  expect(ez_sim_get_pin(42) == HIGH && ez_sim_get_pin(43) == LOW);
+  ez_sim_set_pin(2, HIGH);
+  scan_for(panel, 11);  // switched 11 ms into the pulse
+  scan_for(panel, 29);
+  expect(ez_sim_get_pin(42) == HIGH);
+  scan_for(panel, 1);
+  expect(ez_sim_get_pin(42) == LOW);
+  expect(pin_writes == 0);
+}
+
+#if ez_switch_metrics
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Metrics (built with ez_switch_metrics, see make test-metrics): counts
+// of a bounced toggle and a clean button, and the dump_metrics layout,
+// decoded field by field. The virtual clock stands still during a scan,
+// so every scan takes 0 microsecs, 1000 apart.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_metrics() {
+  ez_sim_reset();
+  Switches panel(3);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  panel.add_switch(button_switch, 3, circuit_C1);
+  panel.add_switch(toggle_switch, 4, circuit_C1);
+  uint32_t num_switched = scan_for(panel, 5);
+
+  // changes read at 6, 7, 8, 9 and 10, the last 4 bounce, settling
+  // over 4 ms, then a clean change back
+  bounce_pin(panel, 2, HIGH, 5);
+  num_switched += scan_for(panel, 30);
+  ez_sim_set_pin(2, LOW);
+  num_switched += scan_for(panel, 30);
+  expect(panel.metrics[0].transitions == 6);
+  expect(panel.metrics[0].bounce_edges == 4);
+  expect(panel.metrics[0].max_settle == 4);
+  expect(panel.metrics[0].events == num_switched && num_switched >= 2);
+
+  // pressed, then released 30 ms later, one press cycle
+  ez_sim_set_pin(3, HIGH);
+  expect(scan_for(panel, 30) == 0);
+  ez_sim_set_pin(3, LOW);
+  expect(scan_for(panel, 30) == 1);
+  expect(panel.metrics[1].transitions == 2 && panel.metrics[1].events == 1);
+  expect(panel.metrics[1].bounce_edges == 0 && panel.metrics[1].max_settle == 0);
+  uint32_t scans = 5 + 5 + 30 + 30 + 30 + 30;
+  expect(panel.scan_stats.scans == scans);
+  expect(panel.scan_stats.min_scan_us == 0 && panel.scan_stats.max_scan_us == 0);
+  expect(panel.scan_stats.max_gap_us == 1000);
+  expect(panel.scan_stats.histogram[0] == scans);
+
+  // 'E', 'Z', 'M', version, switches, bins, then the scan fields, the
+  // histogram and each switch's record, a removed switch's all 0
+  expect(panel.remove_switch(2) == remove_success);
+  Byte_sink dump;
+  panel.dump_metrics(dump);
+  expect(dump.size == 22 + 2 * ez_scan_bins + 8 * 3);
+  expect(memcmp(dump.bytes, "EZM\x01\x03", 5) == 0 && dump.bytes[5] == ez_scan_bins);
+  expect(dump.get_le(6, 4) == scans);
+  expect(dump.get_le(10, 4) == 0 && dump.get_le(14, 4) == 0);
+  expect(dump.get_le(18, 4) == 1000);
+  expect(dump.get_le(22, 2) == scans);
+  bool rest_empty = true;
+  for (uint8_t bin = 1; bin < ez_scan_bins; bin++) {
+    if (dump.get_le(22 + 2 * bin, 2) != 0) rest_empty = false;
+  }
+  expect(rest_empty);
+  size_t record = 22 + 2 * ez_scan_bins;
+  expect(dump.get_le(record, 2) == 6 && dump.get_le(record + 2, 2) == num_switched);
+  expect(dump.get_le(record + 4, 2) == 4 && dump.get_le(record + 6, 2) == 4);
+  record += 8;
+  expect(dump.get_le(record, 2) == 2 && dump.get_le(record + 2, 2) == 1);
+  expect(dump.get_le(record + 4, 2) == 0 && dump.get_le(record + 6, 2) == 0);
+  record += 8;
+  expect(dump.get_le(record, 4) == 0 && dump.get_le(record + 4, 4) == 0);
+
+  // and cleared, the shortest scan back to its start value
+  panel.reset_metrics();
+  Byte_sink cleared;
+  panel.dump_metrics(cleared);
+  expect(cleared.size == dump.size);
+  expect(cleared.get_le(6, 4) == 0 && cleared.get_le(10, 4) == 0xFFFFFFFF);
+  expect(cleared.get_le(22 + 2 * ez_scan_bins, 4) == 0);
+}
+#endif
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Decode the trace record at 'at' of the given stream, returning its
+// size, 0 if the stream ends part way through.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+struct trace_record {
+  uint8_t  switch_id;  // or trace_lost
+  uint32_t value;      // varint, (delta << 1) | contact, or records lost
+};
+
+static size_t get_record(const Byte_sink &stream, size_t at, trace_record &record) {
+  if (at >= stream.size) return 0;
+  record.switch_id = stream.bytes[at];
+  record.value     = 0;
+  for (size_t next = at + 1, shift = 0; next < stream.size && shift < 35; next++, shift += 7) {
+    record.value |= (uint32_t)(stream.bytes[next] & 0x7F) << shift;
+    if ((stream.bytes[next] & 0x80) == 0) return next + 1 - at;
+  }
+  return 0;
+}
+
+static switch_event replayed[32];
+static uint8_t      num_replayed = 0;
+
+static void record_replayed(const switch_event &event, void *context) {
+  if (num_replayed < 32) replayed[num_replayed++] = event;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Trace recording and replay: a bounced toggle and buttons recorded,
+// the records decoded, the lost count recorded once a full buffer has
+// room again, and the trace replayed giving the events of the live run.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_trace() {
+  ez_sim_reset();
+  Switches panel(3);
+  switch_event events[16];
+  panel.switch_events.begin(events, 16);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  panel.add_switch(button_switch, 3, circuit_C1);
+  panel.add_switch(button_switch, 4, circuit_C1);
+  panel.set_debounce(2, 25);
+  panel.set_button_mode(2, button_press_release_mode);
+  uint8_t buffer[128];
+  Switch_trace trace;
+  expect(trace.begin(buffer, trace_min_buffer - 1) == trace_failure);
+  expect(trace.begin(buffer, sizeof(buffer)) == trace_success);
+  trace.record_all();
+  panel.set_trace(&trace);
+  Byte_sink stream;
+  panel.write_trace_header(stream);
+  expect(stream.size == 9 + 3 * 5 && stream.get_le(5, 4) == 0);
+  expect(stream.bytes[19] == button_switch && stream.bytes[20] == button_press_release_mode);
+  expect(stream.get_le(22, 2) == 25);
+
+  // the first readings at 1 ms, then the transitions, each read at
+  // the scan after the change, the press_release button first, within
+  // its debounce period of the start
+  scan_for(panel, 5);
+  bounce_pin(panel, 4, HIGH, 3);
+  scan_for(panel, 40);
+  ez_sim_set_pin(4, LOW);
+  scan_for(panel, 40);
+  bounce_pin(panel, 2, HIGH, 5);
+  scan_for(panel, 30);
+  bounce_pin(panel, 3, HIGH, 3);
+  scan_for(panel, 30);
+  ez_sim_set_pin(3, LOW);
+  scan_for(panel, 30);
+  expect(trace.overflows == 0);
+  expect(trace.drain(stream, 10) == 10);  // part drained, then the rest
+  trace.drain(stream);
+  expect(trace.available() == 0);
+
+  const trace_record expected[16] = {
+    {0, 1000 << 1}, {1, 0}, {2, 0},
+    {2, 5000 << 1 | 1}, {2, 1000 << 1}, {2, 1000 << 1 | 1}, {2, 41000 << 1},
+    {0, 40000 << 1 | 1}, {0, 1000 << 1}, {0, 1000 << 1 | 1}, {0, 1000 << 1}, {0, 1000 << 1 | 1},
+    {1, 31000 << 1 | 1}, {1, 1000 << 1}, {1, 1000 << 1 | 1}, {1, 31000 << 1}};
+  size_t at = 24;
+  uint8_t num_records = 0;
+  bool as_expected = true;
+  trace_record record;
+  for (size_t size; (size = get_record(stream, at, record)) != 0; at += size, num_records++) {
+    if (num_records < 16 && (record.switch_id != expected[num_records].switch_id ||
+                             record.value != expected[num_records].value)) as_expected = false;
+  }
+  expect(num_records == 16 && at == stream.size && as_expected);
+  expect(stream.bytes[24 + 3] == 1 && stream.bytes[24 + 4] == 0);  // a 0 delta in one byte
+
+  // replayed, the same events at the same times as the live run, the
+  // press at 6 ms only if the recorded debounce is set before the mode
+  switch_event live[16];
+  uint8_t num_live = panel.switch_events.pop_events(live, 16);
+  expect(num_live >= 4);
+  panel.set_trace(NULL);
+  replay_summary summary;
+  num_replayed = 0;
+  expect(replay_trace(stream.bytes, stream.size, replay_as_recorded, 1000, record_replayed, NULL, summary) ==
+         replay_success);
+  expect(summary.records == 16 && summary.lost == 0 && !summary.truncated);
+  expect(summary.events == num_live && num_replayed == num_live);
+  bool same = true;
+  for (uint8_t n = 0; n < num_live && n < num_replayed; n++) {
+    if (live[n].switch_id != replayed[n].switch_id || live[n].event_kind != replayed[n].event_kind ||
+        live[n].event_time != replayed[n].event_time) same = false;
+  }
+  expect(same);
+  expect(replay_trace(stream.bytes, 8, replay_as_recorded, 1000, NULL, NULL, summary) == replay_not_trace);
+  expect(replay_trace(stream.bytes, 20, replay_as_recorded, 1000, NULL, NULL, summary) == replay_no_header);
+  expect(replay_trace(stream.bytes, stream.size - 1, replay_as_recorded, 1000, NULL, NULL, summary) ==
+         replay_success && summary.truncated);
+
+  // a full buffer loses records, their number recorded ahead of the
+  // next record kept, whose delta runs from the last kept
+  ez_sim_reset();
+  Switches toggles(1);
+  toggles.add_switch(toggle_switch, 2, circuit_C1);
+  uint8_t small_buffer[trace_min_buffer];
+  Switch_trace small;
+  small.begin(small_buffer, sizeof(small_buffer));
+  small.record_all();
+  toggles.set_trace(&small);
+  for (uint8_t edge = 0; edge < 10; edge++) {
+    ez_sim_set_pin(2, (edge & 1) ? LOW : HIGH);
+    scan_for(toggles, 1);
+  }
+  uint16_t lost = small.overflows;
+  expect(lost > 0);
+  Byte_sink kept;
+  small.drain(kept);
+  uint8_t num_kept = 0;
+  uint32_t kept_us = 0;
+  at = 0;
+  for (size_t size; (size = get_record(kept, at, record)) != 0; at += size, num_kept++) {
+    kept_us += record.value >> 1;
+  }
+  expect(num_kept + lost == 10 && at == kept.size);
+  ez_sim_set_pin(2, HIGH);
+  scan_for(toggles, 1);
+  Byte_sink after;
+  small.drain(after);
+  size_t size = get_record(after, 0, record);
+  expect(size != 0 && record.switch_id == trace_lost && record.value == lost);
+  expect(get_record(after, size, record) != 0 && record.switch_id == 0);
+  expect(record.value == ((11000 - kept_us) << 1 | 1));
+  expect(small.overflows == lost);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Switch removal and slot reuse, and the states/pending bitmasks, with
+// each debounce engine and with interrupt driven scanning.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_remove_switch() {
+  for (uint8_t engine = 0; engine < 3; engine++) {
+    ez_sim_reset();
+    Switches panel(40);
+    Switches::output_link links[2];
+    panel.set_output_links(links, 2);
+    for (uint8_t sw = 0; sw < 40; sw++) panel.add_switch(toggle_switch, sw + 2, circuit_C1);
+    if (engine == 1) panel.set_debounce_engine(vertical_debounce);
+    expect(panel.add_output_link(33, 100, link_toggle) == 0);
+    expect(panel.add_output_link(35, 101, link_toggle) == 1);
+    uint32_t switched_mask[2];
+    panel.scan_dirty_switches(switched_mask);
+
+    // switches 33 to 35 on
+    for (uint8_t sw = 33; sw <= 35; sw++) ez_sim_set_pin(sw + 2, HIGH);
+    for (uint8_t step = 0; step < 20; step++) {
+      ez_sim_advance_ms(1);
+      if (engine == 2) {
+        for (uint8_t sw = 33; sw <= 35; sw++) panel.mark_switch_dirty(sw);
+        panel.scan_dirty_switches(switched_mask);
+      } else {
+        panel.read_all_switches(switched_mask);
+      }
+    }
+    uint32_t states[2], pending[2];
+    panel.states(states);
+    expect(states[0] == 0 && states[1] == 0xE);
+
+    // removed - bits cleared, links closed up, never reported again
+    expect(panel.remove_switch(33) == remove_success);
+    expect(panel.remove_switch(33) == remove_failure);
+    expect(panel.remove_switch(40) == remove_failure);
+    expect(panel.remove_switch(5) == remove_success);
+    expect(panel.num_free_switch_slots() == 2);
+    panel.states(states);
+    expect(states[1] == 0xC);
+    expect(panel.add_output_link(35, 102, link_toggle) == 1);  // link 1 moved to 0
+    ez_sim_set_pin(33 + 2, LOW);
+    ez_sim_set_pin(5 + 2, HIGH);
+    ez_sim_set_pin(34 + 2, LOW);
+    panel.mark_all_dirty();
+    uint8_t num_switched = 0;
+    for (uint8_t step = 0; step < 20; step++) {
+      ez_sim_advance_ms(1);
+      if (engine == 2) {
+        num_switched += panel.scan_dirty_switches(switched_mask);
+      } else {
+        num_switched += panel.read_all_switches(switched_mask);
+      }
+      expect((switched_mask[0] & ((uint32_t)1 << 5)) == 0 && (switched_mask[1] & 0x2) == 0);
+    }
+    expect(num_switched == 1);  // switch 34 only
+    expect(!panel.read_switch(33));
+    panel.pending(pending);
+    expect(pending[0] == 0 && pending[1] == 0);
+
+    // reused, most recently removed first, starting afresh
+    expect(panel.add_switch(button_switch, 60, circuit_C1) == 5);
+    expect(panel.add_switch(toggle_switch, 61, circuit_C1) == 33);
+    expect(panel.add_switch(toggle_switch, 62, circuit_C1) == add_failure);
+    expect(panel.num_free_switch_slots() == 0);
+    ez_sim_set_pin(60, HIGH);  // held, so pending once debounced, whichever engine
+    for (uint8_t step = 0; step < 25; step++) {
+      ez_sim_advance_ms(1);
+      panel.mark_pin_dirty(60);
+      if (engine == 2) panel.scan_dirty_switches(switched_mask); else panel.read_all_switches(switched_mask);
+    }
+    panel.pending(pending);
+    expect(pending[0] == (uint32_t)1 << 5 && pending[1] == 0);
+    panel.states(states);
+    expect(states[0] == 0 && states[1] == 0x8);
+  }
+
+  // the last switch, a reused slot, may be reset, and the trace header
+  // keeps the switch_ids of removed switches
+  ez_sim_reset();
+  Switches panel(3);
+  for (uint8_t sw = 0; sw < 3; sw++) panel.add_switch(button_switch, sw + 2, circuit_C1);
+  panel.remove_switch(2);
+  panel.remove_switch(1);
+  expect(panel.add_switch(button_switch, 10, circuit_C1) == 1);
+  ez_sim_set_pin(10, HIGH);
+  scan_for(panel, 3);
+  expect(panel.pending() == 0x2);
+  panel.reset_switch(1);
+  expect(panel.pending() == 0);
+  Byte_sink header;
+  panel.write_trace_header(header);
+  expect(header.size == 9 + 3 * 5 && header.bytes[4] == 3);
+  expect(header.bytes[9] == button_switch && header.bytes[14] == button_switch);
+  expect(header.bytes[19] == trace_no_switch);
+
+  // reset switches leave the deadline heap, so interrupt driven
+  // scanning goes idle
+  ez_sim_reset();
+  Switches toggles(3);
+  for (uint8_t sw = 0; sw < 3; sw++) toggles.add_switch(toggle_switch, sw + 2, circuit_C1);
+  toggles.set_debounce(0, 50);
+  uint32_t switched_mask[1];
+  toggles.scan_dirty_switches(switched_mask);
+  for (uint8_t sw = 0; sw < 3; sw++) ez_sim_set_pin(sw + 2, HIGH);
+  for (uint8_t sw = 0; sw < 3; sw++) toggles.mark_switch_dirty(sw);
+  toggles.scan_dirty_switches(switched_mask);
+  expect(toggles.next_deadline() == 10);
+  toggles.reset_switch(1);
+  toggles.reset_switch(2);
+  expect(toggles.next_deadline() == 50);
+  toggles.reset_switches();
+  expect(toggles.next_deadline() == no_deadline && toggles.switches_idle());
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Matrix keypad scanning on the simulated keypad, with and without
+// diodes. The keys are toggle switches, so 'on' whilst held, key (row,
+// col) being bit row * 4 + col of the states.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static const uint8_t matrix_rows[4] = {20, 21, 22, 23};
+static const uint8_t matrix_cols[4] = {30, 31, 32, 33};
+
+#define key_bit(row, col) ((uint32_t)1 << ((row) * 4 + (col)))
+
+static uint32_t keys_after(Switches &panel, uint32_t ms) {
+  scan_for(panel, ms);
+  return panel.states();
+}
+
+static void check_matrix() {
+  for (uint8_t diodes = 0; diodes < 2; diodes++) {
+    ez_sim_reset();
+    Switches panel(17);
+    expect(panel.add_switch(toggle_switch, 2, circuit_C1) == 0);
+    expect(panel.add_matrix(matrix_rows, 4, matrix_cols, 5, toggle_switch, diodes) == add_failure);  // too many keys
+    expect(panel.add_matrix(matrix_rows, 4, matrix_cols, 4, toggle_switch, diodes) == 1);
+    expect(panel.add_matrix(matrix_rows, 1, matrix_cols, 1, toggle_switch, diodes) == add_failure);  // one only
+    expect(panel.remove_switch(5) == remove_failure);  // keys may not be removed
+    ez_sim_attach_matrix(matrix_rows, 4, matrix_cols, 4, diodes);
+    // states are of switch_ids, the keys from switch_id 1
+    expect(keys_after(panel, 20) == 0);
+
+    // three corners of a rectangle pressed at once
+    ez_sim_set_key(0, 0, true);
+    ez_sim_set_key(0, 1, true);
+    ez_sim_set_key(1, 0, true);
+    uint32_t corners = key_bit(0, 0) | key_bit(0, 1) | key_bit(1, 0);
+    if (diodes) {
+      expect(keys_after(panel, 20) >> 1 == corners);
+    } else {
+      // the fourth, (1, 1), reads pressed, so all four are ambiguous
+      // and keep their previous readings - all four lost
+      expect(keys_after(panel, 20) >> 1 == 0);
+    }
+    // the rectangle broken, the two keys left are read
+    ez_sim_set_key(1, 0, false);
+    expect(keys_after(panel, 20) >> 1 == (key_bit(0, 0) | key_bit(0, 1)));
+    // the third corner pressed once the first two are on - those two
+    // keep their readings, the third (and the ghost) stay off
+    ez_sim_set_key(1, 0, true);
+    if (diodes) {
+      expect(keys_after(panel, 20) >> 1 == corners);
+    } else {
+      expect(keys_after(panel, 20) >> 1 == (key_bit(0, 0) | key_bit(0, 1)));
+    }
+    // all four pressed - with diodes all four are read
+    ez_sim_set_key(1, 1, true);
+    if (diodes) {
+      expect(keys_after(panel, 20) >> 1 == (corners | key_bit(1, 1)));
+    } else {
+      expect(keys_after(panel, 20) >> 1 == (key_bit(0, 0) | key_bit(0, 1)));
+    }
+    // keys in other rows and columns are unaffected
+    ez_sim_set_key(3, 3, true);
+    expect((keys_after(panel, 20) >> 1 & key_bit(3, 3)) != 0);
+    for (uint8_t row = 0; row < 4; row++) {
+      for (uint8_t col = 0; col < 4; col++) ez_sim_set_key(row, col, false);
+    }
+    expect(keys_after(panel, 20) == 0);
+  }
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Input banks: a chain of two 74HC165s, simulated behind a backend
+// wrapping the simulator's, and I2C expanders on the mock I2C bus.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+#define shift_load   50
+#define shift_clock  51
+#define shift_data   52
+
+static uint8_t  shift_inputs[2];  // levels at the chips' D0-D7, chip 0 nearest data_pin
+static uint16_t shift_register;   // as latched, next bit out at the top
+
+static void shift_write_pin(uint8_t pin, uint8_t level) {
+  if (pin == shift_load && level == LOW) {
+    shift_register = (uint16_t)shift_inputs[0] << 8 | shift_inputs[1];
+  } else if (pin == shift_clock && level == HIGH) {
+    shift_register <<= 1;
+  }
+  ez_sim_io.write_pin(pin, level);
+  ez_sim_set_pin(shift_data, (shift_register & 0x8000) ? HIGH : LOW);  // Q7 of chip 0
+}
+
+static void check_input_banks() {
+  ez_io_backend shift_io = ez_sim_io;
+  shift_io.write_pin = shift_write_pin;
+  ez_sim_reset();
+  Switches panel(6);
+  Shift_in_bank<2> chain(shift_load, shift_clock, shift_data, &shift_io);
+  chain.begin();
+  shift_inputs[0] = shift_inputs[1] = 0;
+  Mock_wire wire(0x20);
+  I2c_bank<Mock_wire, 2> mcp23017(wire, 0x20, 0x12);
+  I2c_bank<Mock_wire, 1> missing(wire, 0x27);
+  expect(panel.add_bank(chain) == 0);
+  expect(panel.add_bank(mcp23017) == 1);
+  expect(panel.add_bank(missing) == 2);
+  expect(missing.errors == 1);  // no such device
+  expect(panel.add_switch(toggle_switch, 2, circuit_C1) == 0);
+  expect(panel.add_bank_switch(toggle_switch, 0, 0, circuit_C1) == 1);   // chip 0, D0
+  expect(panel.add_bank_switch(toggle_switch, 0, 15, circuit_C1) == 2);  // chip 1, D7
+  expect(panel.add_bank_switch(toggle_switch, 1, 3, circuit_C2) == 3);   // GPIOA 3
+  expect(panel.add_bank_switch(toggle_switch, 1, 12, circuit_C2) == 4);  // GPIOB 4
+  expect(panel.add_bank_switch(toggle_switch, 3, 0, circuit_C1) == bad_params);  // no such bank
+  expect(panel.add_bank_switch(toggle_switch, 1, 16, circuit_C1) == bad_params); // no such input
+  expect(keys_after(panel, 20) == 0);
+
+  // each input reaches just its own switch
+  shift_inputs[0] = 0x01;
+  expect(keys_after(panel, 20) == 0x02);
+  shift_inputs[1] = 0x80;
+  expect(keys_after(panel, 20) == 0x06);
+  shift_inputs[0] = 0xFE;  // all but D0 of chip 0, no switches on them
+  expect(keys_after(panel, 20) == 0x04);
+  wire.reg[0x12] = 0xF7;
+  expect(keys_after(panel, 20) == 0x0C);
+  wire.reg[0x13] = 0xEF;
+  expect(keys_after(panel, 20) == 0x1C);
+  expect(mcp23017.errors == 0);
+  // a failing bus keeps the last levels, counting the failures
+  wire.fail = true;
+  wire.reg[0x12] = 0xFF;
+  uint16_t missing_errors = missing.errors;
+  expect(keys_after(panel, 20) == 0x1C);
+  expect(mcp23017.errors == 20 && missing.errors == missing_errors + 20);
+  wire.fail = false;
+  expect(keys_after(panel, 20) == 0x14);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Wait for the scanner thread to make a scan beyond its first 'scans',
+// returning false should it not within a second of real time.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static bool scan_made(Switch_scanner &scanner, uint32_t scans) {
+  for (uint16_t waits = 0; scanner.scans == scans; waits++) {
+    if (waits == 10000) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Move the virtual clock on 'ms' millisecs, one at a time, each time
+// waiting for the scanner thread to make its scan.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static bool scanned_for(Switch_scanner &scanner, uint32_t ms) {
+  for (uint32_t step = 0; step < ms; step++) {
+    uint32_t scans = scanner.scans;
+    ez_sim_advance_ms(1);
+    if (!scan_made(scanner, scans)) return false;
+  }
+  return true;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Concurrent scanner: the scanner thread scans as the virtual clock is
+// moved on from here, publishing states and queuing events, counting
+// overruns when the clock jumps, and hands the instance back on stop.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void check_scanner() {
+  ez_sim_reset();
+  Switches panel(3);
+  switch_event events[8];
+  switch_event event;
+  panel.switch_events.begin(events, 8);
+  panel.add_switch(toggle_switch, 2, circuit_C1);
+  panel.add_switch(button_switch, 3, circuit_C1);
+  panel.add_switch(toggle_switch, 4, circuit_C1);
+  Switch_scanner scanner(panel);
+  uint32_t on_bits[1], pending_bits[1];
+  expect(scanner.read_states(on_bits, pending_bits, 1) == 0);  // none published
+  expect(scanner.start(0) == scanner_failure);
+  expect(scanner.start(1) == scanner_success);
+  expect(scanner.is_running());
+  expect(scanner.start(1) == scanner_failure);
+  expect(!scanner.scan_once());  // the thread alone scans
+  expect(scan_made(scanner, 0));  // the first at once
+
+  expect(scanned_for(scanner, 5));
+  ez_sim_set_pin(2, HIGH);
+  ez_sim_set_pin(3, HIGH);
+  expect(scanned_for(scanner, 30));
+  expect(scanner.read_states(on_bits, pending_bits, 1) == scanner.scans);
+  expect(on_bits[0] == 0x01 && pending_bits[0] == 0x02);
+  ez_sim_set_pin(3, LOW);
+  ez_sim_set_pin(4, HIGH);
+  expect(scanned_for(scanner, 20));
+  scanner.read_states(on_bits, pending_bits, 1);
+  expect(on_bits[0] == 0x05 && pending_bits[0] == 0);
+  expect(panel.switch_events.available() == 3);
+  expect(panel.switch_events.pop(event) && event.switch_id == 0 && event.event_kind == toggle_on_event);
+  expect(event.event_time == 16);  // change seen at 6, then the 10 ms debounce period
+  expect(panel.switch_events.pop(event) && event.switch_id == 1 && event.event_kind == button_cycle_event);
+  expect(panel.switch_events.pop(event) && event.switch_id == 2 && event.event_kind == toggle_on_event);
+  expect(event.event_time == 46);
+  expect(scanner.overruns == 0);
+
+  // the clock jumping several periods is one overrun, then on time again
+  uint32_t scans = scanner.scans;
+  ez_sim_advance_ms(4);
+  expect(scanned_for(scanner, 1));
+  expect(scanner.overruns == 1);
+  expect(scanned_for(scanner, 10));
+  expect(scanner.overruns == 1 && scanner.scans == scans + 11);
+
+  // stopped, the instance is read directly again
+  scanner.stop();
+  expect(!scanner.is_running());
+  scans = scanner.scans;
+  ez_sim_set_pin(2, LOW);
+  expect(scan_for(panel, 20) == 1);
+  expect(panel.states() == 0x04);
+  expect(panel.switch_events.pop(event) && event.switch_id == 0 && event.event_kind == toggle_off_event);
+  expect(scanner.scans == scans);
+  expect(scanner.start(1) == scanner_success);  // and may be restarted
+  expect(scan_made(scanner, scans));
+  scanner.stop();
+}
+
+int main() {
+  check_vertical();
+  check_static();
+  check_event_queue();
+  check_dirty_scanning();
+  check_set_debounce();
+  check_leading_edge();
+  check_time_wrap();
+  check_handlers();
+  check_output_links();
+#if ez_switch_metrics
+  check_metrics();
+#endif
+  check_trace();
+  check_remove_switch();
+  check_matrix();
+  check_input_banks();
+  check_scanner();
+  printf("ez_switch_test: %u checks, %u failed\n", num_checks, num_failures);
+  return num_failures == 0 ? 0 : 1;
+}
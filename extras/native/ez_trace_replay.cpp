@@ -0,0 +1,150 @@
+// Arduino Switch Library - native trace replay decoder.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <string.h>
+#include "ez_trace_replay.h"
+#include "ez_switch_sim.h"
+
+#define header_size   9           // bytes before the per switch entries
+#define entry_size    5           // bytes per switch entry
+
+// A replay in progress
+struct replay {
+  const uint8_t *trace;
+  size_t         size;
+  size_t         pos;             // next trace byte to decode
+  Switches      *panel;
+  uint8_t        num_switches;
+  replay_handler handler;
+  void          *context;
+  uint32_t       events;
+};
+
+static uint32_t get_le(const uint8_t *bytes, uint8_t width) {
+  uint32_t value = 0;
+  for (uint8_t b = 0; b < width; b++) value |= (uint32_t)bytes[b] << (8 * b);
+  return value;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Decode the varint at 'pos', returning false if the trace ends part
+// way through.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static bool get_varint(replay &run, uint64_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; run.pos < run.size && shift < 64; shift += 7) {
+    uint8_t next = run.trace[run.pos++];
+    value |= (uint64_t)(next & 0x7F) << shift;
+    if ((next & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Read every switch once at the current virtual time, passing on any
+// events reported.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void scan(replay &run) {
+  switch_event event;
+  for (uint8_t sw = 0; sw < run.num_switches; sw++) {
+    if (run.panel->read_switch(sw) != switched) continue;
+    while (run.panel->switch_events.pop(event)) {
+      if (run.handler != NULL) run.handler(event, run.context);
+      run.events++;
+    }
+  }
+}
+
+static bool any_pending(replay &run) {
+  for (uint8_t sw = 0; sw < run.num_switches; sw++) {
+    if (run.panel->switches[sw].switch_pending) return true;
+  }
+  return false;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Replay the given trace of 'size' bytes, header first, scanning every
+// 'scan_us' microsecs whilst switches are pending, passing each switch
+// event to 'handler' (if not NULL) with 'context', and filling in the
+// summary.
+// Returns replay_success, replay_not_trace or replay_no_header.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int replay_trace(const uint8_t *trace, size_t size, uint32_t debounce, uint32_t scan_us,
+                 replay_handler handler, void *context, replay_summary &summary) {
+  memset(&summary, 0, sizeof(summary));
+  if (scan_us == 0) scan_us = 1;
+
+  // the header, see ez_switch_trace.h
+  if (size < header_size || memcmp(trace, "EZT", 3) != 0 || trace[3] != trace_version) {
+    return replay_not_trace;
+  }
+  uint8_t num_switches = trace[4];
+  summary.start_us     = get_le(trace + 5, 4);
+  summary.end_us       = summary.start_us;
+  if (num_switches == 0 || size < header_size + (size_t)entry_size * num_switches) {
+    return replay_no_header;
+  }
+  ez_sim_reset();
+  Switches panel(num_switches);
+  switch_event events[128];
+  panel.switch_events.begin(events, 128);
+  for (uint8_t sw = 0; sw < num_switches; sw++) {
+    const uint8_t *entry = trace + header_size + (size_t)entry_size * sw;
+    panel.add_switch(entry[0] == button_switch ? button_switch : toggle_switch, sw, circuit_C1);
+    // the debounce period first, set_button_mode clearing the lockout by it
+    panel.set_debounce(sw, debounce != replay_as_recorded ? debounce : get_le(entry + 3, 2));
+    panel.set_button_mode(sw, entry[1]);
+  }
+  // switch_ids of switches removed on-device stay unused
+  for (uint8_t sw = 0; sw < num_switches; sw++) {
+    if (trace[header_size + (size_t)entry_size * sw] == trace_no_switch) panel.remove_switch(sw);
+  }
+  replay run = {trace, size, header_size + (size_t)entry_size * num_switches, &panel,
+                num_switches, handler, context, 0};
+
+  // the records, each switch on the pin of its switch_id, HIGH being 'on'
+  uint64_t now_us    = summary.start_us;  // virtual time of the latest scan
+  uint64_t record_us = summary.start_us;  // virtual time of the latest record
+  ez_sim_set_time_us(now_us);
+  while (run.pos < run.size) {
+    uint8_t  switch_id = run.trace[run.pos++];
+    uint64_t value;
+    if (!get_varint(run, value)) {
+      summary.truncated = true;
+      break;
+    }
+    if (switch_id == trace_lost) {
+      summary.lost += value;
+      continue;
+    }
+    record_us += value >> 1;
+    // scan at the scan period up to the transition whilst switches are pending
+    while (now_us + scan_us < record_us && any_pending(run)) {
+      now_us += scan_us;
+      ez_sim_set_time_us(now_us);
+      scan(run);
+    }
+    now_us = record_us;
+    ez_sim_set_time_us(now_us);
+    if (switch_id < num_switches) ez_sim_set_pin(switch_id, (value & 1) ? HIGH : LOW);
+    scan(run);
+    summary.records++;
+  }
+  // run on until all switches settle, at most a minute
+  for (uint32_t scans = 0; any_pending(run) && scans < 60000000 / scan_us; scans++) {
+    now_us += scan_us;
+    ez_sim_set_time_us(now_us);
+    scan(run);
+  }
+  summary.events = run.events;
+  summary.end_us = now_us;
+  return replay_success;
+} // End replay_trace
@@ -0,0 +1,50 @@
+// Arduino Switch Library - native trace replay decoder.
+//
+// Decodes a switch pin trace, as recorded on-device by Switch_trace and
+// drained to a stream (see ez_switch_trace.h), and replays it through
+// read_switch on the simulated GPIO/virtual clock, passing each switch
+// event reported to the given handler. Used by the replay tool (see
+// ez_switch_replay.cpp) and by the behaviour checks.
+//
+// The switches are configured from the trace header, each on the pin
+// of its switch_id. Every switch is read at each recorded transition,
+// and every 'scan_us' microsecs whilst any switch is pending (in
+// debounce, or a button held), as the device would; otherwise the
+// virtual clock jumps straight to the next transition. The debounce
+// period of every switch may be overridden, for tuning, or left as
+// recorded with replay_as_recorded.
+//
+// The simulator is reset by each replay.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_trace_replay_h
+#define ez_trace_replay_h
+#include <stddef.h>
+#include "ez_switch_lib.h"
+
+#define replay_success        0      // trace replayed
+#define replay_not_trace     -1      // not a version trace_version switch trace
+#define replay_no_header     -2      // trace header incomplete
+#define replay_as_recorded   0xFFFFFFFF  // 'debounce', each switch's recorded period
+
+// Replay summary
+struct replay_summary {
+  uint32_t records;     // transition records replayed
+  uint64_t lost;        // records lost on-device, see trace_lost
+  uint32_t events;      // switch events reported
+  bool     truncated;   // trace ends part way through a record
+  uint64_t start_us;    // virtual time of the trace start, microsecs
+  uint64_t end_us;      // virtual time of the last scan, microsecs
+};
+
+typedef void (*replay_handler)(const switch_event &event, void *context);
+
+int replay_trace(const uint8_t *trace, size_t size, uint32_t debounce, uint32_t scan_us,
+                 replay_handler handler, void *context, replay_summary &summary);
+
+#endif
@@ -0,0 +1,161 @@
+// Arduino Switch Library - input banks, ie switches on shift registers
+// and GPIO expanders.
+//
+// An input bank is a group of inputs fetched together in one bulk
+// transfer, eg a chain of 74HC165 shift registers clocked out in one
+// burst, or the input port(s) of an I2C GPIO expander read in one
+// register read. The fetched levels are cached in the bank's 'bits',
+// and switches on the bank (see Switches::add_bank and
+// Switches::add_bank_switch) are debounced from the cache exactly as
+// switches on digital pins, so there is no bus transfer per switch.
+//
+// Banks offered here:
+//
+//   Shift_in_bank<chips>  - a chain of 'chips' 74HC165 (parallel in,
+//                           serial out) shift registers, bit-banged on
+//                           three pins, eg
+//                             Shift_in_bank<2> my_bank(load_pin, clock_pin, data_pin);
+//                           Input n is pin D(n % 8) of chip n / 8, chip 0
+//                           being that whose serial output (Q7) is wired
+//                           to 'data_pin'.
+//
+//   I2c_bank<Wire_t, bytes>
+//                         - 'bytes' input ports of an I2C GPIO expander,
+//                           read by the given Wire-like object (eg Wire,
+//                           of class TwoWire) from 'reg' onwards, or with
+//                           no register write if 'reg' is no_register, eg
+//                             I2c_bank<TwoWire, 1> my_pcf8574(Wire, 0x20);
+//                             I2c_bank<TwoWire, 2> my_mcp23017(Wire, 0x20, 0x12);
+//                           Input n is bit n % 8 of port byte n / 8. The
+//                           expander must be configured (eg MCP23017 pull
+//                           ups) by the sketch, and Wire.begin() called.
+//
+// Other banks, eg SPI expanders, may be added by deriving from Input_bank
+// and providing 'fetch'.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_input_bank_h
+#define ez_input_bank_h
+#include <Arduino.h>
+#include "ez_switch_io.h"
+
+#define ez_max_banks          4      // max input banks per Switches instance
+#define ez_max_bank_bytes     8      // max inputs per bank, in bytes, ie 64 inputs
+#define no_register          -1      // I2c_bank, expander read without a register write
+
+class Input_bank
+{
+  public:
+    // Fetch all inputs into 'bits' in one bulk transfer
+    virtual void fetch() = 0;
+
+    uint8_t *bits;        // cached input levels, bit n % 8 of byte n / 8, set = HIGH
+    uint8_t  num_inputs;  // inputs on the bank
+
+  protected:
+    // Banks are never deleted via an Input_bank pointer, so no virtual
+    // destructor (and its vtable cost on AVR) is needed
+    ~Input_bank() {}
+};
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Chain of 74HC165 shift registers. The chain's parallel inputs are
+// latched by pulsing 'load_pin' (PL) LOW, then shifted out on 'data_pin'
+// (Q7), D7 of each chip first, one bit per 'clock_pin' (CP) pulse.
+// Pins are accessed via the given backend, the Arduino core by default.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+template <uint8_t chips>
+class Shift_in_bank : public Input_bank
+{
+    static_assert(chips > 0 && chips <= ez_max_bank_bytes, "Shift_in_bank - 1 to 8 chips");
+  public:
+    Shift_in_bank(uint8_t load_pin, uint8_t clock_pin, uint8_t data_pin,
+                  const ez_io_backend *io = &ez_arduino_io)
+      : _load_pin(load_pin), _clock_pin(clock_pin), _data_pin(data_pin), _io(io) {
+      bits       = _bits;
+      num_inputs = chips * 8;
+      for (uint8_t chip = 0; chip < chips; chip++) _bits[chip] = 0;
+    }
+
+    // Establish the pins, call from setup()
+    void begin() {
+      _io->set_pin_mode(_load_pin, OUTPUT);
+      _io->write_pin(_load_pin, HIGH);
+      _io->set_pin_mode(_clock_pin, OUTPUT);
+      _io->write_pin(_clock_pin, LOW);
+      _io->set_pin_mode(_data_pin, INPUT);
+    }
+
+    void fetch() {
+      _io->write_pin(_load_pin, LOW);   // latch the parallel inputs
+      _io->write_pin(_load_pin, HIGH);
+      for (uint8_t chip = 0; chip < chips; chip++) {
+        uint8_t value = 0;
+        for (uint8_t bit = 8; bit-- > 0;) {
+          if (_io->read_pin(_data_pin) == HIGH) value |= 1 << bit;
+          _io->write_pin(_clock_pin, HIGH);  // next bit on to Q7
+          _io->write_pin(_clock_pin, LOW);
+        }
+        _bits[chip] = value;
+      }
+    }
+
+  private:
+    uint8_t _load_pin;
+    uint8_t _clock_pin;
+    uint8_t _data_pin;
+    const ez_io_backend *_io;
+    uint8_t _bits[chips];
+};
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// I2C GPIO expander input ports, read in one transaction. Should the
+// read fail, or return short, the previous levels are kept and the
+// failure counted in 'errors'.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+template <typename Wire_t, uint8_t bytes>
+class I2c_bank : public Input_bank
+{
+    static_assert(bytes > 0 && bytes <= ez_max_bank_bytes, "I2c_bank - 1 to 8 bytes");
+  public:
+    I2c_bank(Wire_t &wire, uint8_t address, int16_t reg = no_register)
+      : _wire(wire), _address(address), _reg(reg) {
+      bits       = _bits;
+      num_inputs = bytes * 8;
+      for (uint8_t port = 0; port < bytes; port++) _bits[port] = 0xFF;  // as if pulled up
+    }
+
+    void fetch() {
+      if (_reg != no_register) {
+        _wire.beginTransmission(_address);
+        _wire.write((uint8_t)_reg);
+        if (_wire.endTransmission(false) != 0) {  // repeated start
+          errors++;
+          return;
+        }
+      }
+      if (_wire.requestFrom(_address, bytes) != bytes) {
+        while (_wire.available()) _wire.read();  // discard any partial read
+        errors++;
+        return;
+      }
+      for (uint8_t port = 0; port < bytes; port++) _bits[port] = _wire.read();
+    }
+
+    uint16_t errors = 0;  // failed fetches
+
+  private:
+    Wire_t  &_wire;
+    uint8_t  _address;
+    int16_t  _reg;
+    uint8_t  _bits[bytes];
+};
+
+#endif
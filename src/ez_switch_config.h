@@ -0,0 +1,54 @@
+// Arduino Switch Library - compile time configuration.
+//
+// Options are set by editing the values below, as the library's source
+// files are compiled separately from the sketch and so do not see any
+// #defines made in the sketch. Alternatively, with build systems that
+// allow it (eg PlatformIO build_flags), define them on the command line.
+//
+//   ez_switch_short_time - 0, switch times are held as 32 bit millisecs
+//                              (the default),
+//                          1, switch times are held as 16 bit millisecs,
+//                              saving 2 bytes per switch, eg on AVR
+//                              boards with many switches. Debounce
+//                              periods must then be less than 32768
+//                              millisecs. Event times (see
+//                              ez_switch_events.h) are always 32 bit.
+//
+//   ez_switch_metrics    - 0, no metrics (the default),
+//                          1, switch and scan metrics are recorded, see
+//                              Switches::print_metrics, at a cost of 17
+//                              bytes per switch on AVR boards (20 on 32
+//                              bit boards) plus a few microsecs per scan.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_switch_config_h
+#define ez_switch_config_h
+#include <Arduino.h>
+
+#ifndef ez_switch_short_time
+#define ez_switch_short_time  0
+#endif
+
+#ifndef ez_switch_metrics
+#define ez_switch_metrics     0
+#endif
+
+// Switch time stamps, and their signed difference for comparing times
+// either side of a clock roll over
+#if ez_switch_short_time
+typedef uint16_t ez_time_t;
+typedef int16_t  ez_time_diff_t;
+#else
+typedef uint32_t ez_time_t;
+typedef int32_t  ez_time_diff_t;
+#endif
+
+// Millisecs elapsed from time stamp 'since' to clock time 'now'
+#define ez_elapsed(now, since) ((ez_time_t)((ez_time_t)(now) - (ez_time_t)(since)))
+
+#endif
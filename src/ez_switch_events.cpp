@@ -0,0 +1,90 @@
+// Arduino Switch Library - switch event queue.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <Arduino.h>
+#include "ez_switch_events.h"
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Establish the queue in the given buffer, which must hold 'capacity'
+// events, capacity being a power of 2 from 2 to 128.
+// Returns queue_success or queue_failure.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switch_event_queue::begin(switch_event *buffer, uint8_t capacity) {
+  if (buffer == NULL || capacity < 2 || capacity > 128 || (capacity & (capacity - 1)) != 0) {
+    return queue_failure;
+  }
+  _head     = 0;
+  _tail     = 0;
+  _mask     = capacity - 1;
+  overflows = 0;
+  _buffer   = buffer;
+  return queue_success;
+} // End begin
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Producer end - add an event, returning false if the queue is full,
+// in which case the event is dropped and counted as an overflow.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switch_event_queue::push(uint8_t switch_id, uint8_t event_kind, uint32_t event_time) {
+  if (_buffer == NULL) return false;  // not established
+  uint8_t head = _head;
+  if ((uint8_t)(head - _tail) > _mask) {
+    // full
+    if (overflows < 0xFFFF) overflows++;
+    return false;
+  }
+  switch_event &event = _buffer[head & _mask];
+  event.switch_id  = switch_id;
+  event.event_kind = event_kind;
+  event.event_time = event_time;
+  ez_memory_barrier();  // event written before it is published
+  _head = head + 1;
+  return true;
+} // End push
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Consumer end - take the oldest event, returning false if none.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switch_event_queue::pop(switch_event &event) {
+  uint8_t tail = _tail;
+  if (tail == _head) return false;  // empty
+  ez_memory_barrier();  // event read after it was published
+  event = _buffer[tail & _mask];
+  ez_memory_barrier();  // event read before its slot is released
+  _tail = tail + 1;
+  return true;
+} // End pop
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Consumer end - take up to 'max_events' events, oldest first, in one
+// batch, returning the number taken.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint8_t Switch_event_queue::pop_events(switch_event events[], uint8_t max_events) {
+  uint8_t tail  = _tail;
+  uint8_t count = (uint8_t)(_head - tail);
+  if (count > max_events) count = max_events;
+  ez_memory_barrier();
+  for (uint8_t n = 0; n < count; n++) {
+    events[n] = _buffer[(uint8_t)(tail + n) & _mask];
+  }
+  ez_memory_barrier();
+  _tail = tail + count;
+  return count;
+} // End pop_events
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Number of events waiting.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint8_t Switch_event_queue::available() {
+  return (uint8_t)(_head - _tail);
+} // End available
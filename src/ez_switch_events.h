@@ -0,0 +1,78 @@
+// Arduino Switch Library - switch event queue.
+//
+// A bounded, lock-free, single producer/single consumer ring buffer of
+// switch events. When established for a Switches instance (see
+// Switches::switch_events) every switch transition reported by the read
+// functions is queued, so that no transition is lost when several
+// switches are switched before the consumer, eg an ISR or the main
+// loop, gets to look. Compare with 'last_switched_id', which only ever
+// records the latest switch to be switched.
+//
+// The producer (the switch read functions) and the consumer may run in
+// different contexts, eg main loop and ISR, without disabling
+// interrupts, providing each end is only used from one context. Events
+// arriving when the queue is full are dropped and counted in 'overflows'.
+//
+// The event kinds are also those given to switch handlers, see
+// Switches::poll.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_switch_events_h
+#define ez_switch_events_h
+#include <Arduino.h>
+
+#define toggle_on_event       1      // toggle switch switched to on
+#define toggle_off_event      2      // toggle switch switched to off
+#define button_cycle_event    3      // button switch press/release cycle complete
+#define button_press_event    4      // button switch pressed, button_press(_release)_mode
+#define button_release_event  5      // button switch released, button_press_release_mode
+#define ez_event_mask(kind)  (1 << (kind))  // handler event kinds, see Switches::set_switch_handler
+#define all_events         0x3E      // all of the above event kinds
+
+#define queue_success         0      // event queue established
+#define queue_failure        -1      // event queue capacity not a power of 2, 2-128
+
+// Ensures queue contents are written before the indices that publish
+// them, and read after, including between cores on multi-core boards.
+#if defined(__AVR__)
+#define ez_memory_barrier() __asm__ __volatile__("" ::: "memory")
+#else
+#define ez_memory_barrier() __sync_synchronize()
+#endif
+
+// Switch handler, called by Switches::poll with the switch and kind of
+// each event, and the context given when the handler was set
+typedef void (*switch_handler)(uint8_t switch_id, uint8_t event_kind, void *context);
+
+struct switch_event {
+  uint8_t  switch_id;    // the switch that switched
+  uint8_t  event_kind;   // toggle_on_event, toggle_off_event, button_cycle_event,
+                         // button_press_event or button_release_event
+  uint32_t event_time;   // time of the event, millisecs
+};
+
+class Switch_event_queue
+{
+  public:
+    int     begin      (switch_event *buffer, uint8_t capacity);
+    bool    push       (uint8_t switch_id, uint8_t event_kind, uint32_t event_time);
+    bool    pop        (switch_event &event);
+    uint8_t pop_events (switch_event events[], uint8_t max_events);
+    uint8_t available  ();
+    bool    is_enabled () { return _buffer != NULL; }
+
+    volatile uint16_t overflows = 0;   // events dropped as queue full
+
+  private:
+    switch_event    *_buffer = NULL;   // user supplied event storage
+    uint8_t          _mask   = 0;      // capacity - 1
+    volatile uint8_t _head   = 0;      // free running count of events pushed, producer owned
+    volatile uint8_t _tail   = 0;      // free running count of events popped, consumer owned
+};
+
+#endif
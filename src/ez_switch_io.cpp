@@ -0,0 +1,114 @@
+// Arduino Switch Library - default (Arduino core) input/output and clock backend.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <Arduino.h>
+#include "ez_switch_io.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+portMUX_TYPE ez_critical_mux = portMUX_INITIALIZER_UNLOCKED;  // see ez_critical_begin
+#endif
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Thin wrappers around the Arduino core functions. These are needed as
+// the core functions' signatures differ between board packages (eg
+// PinStatus/PinMode enums on some cores), so cannot be taken directly.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static uint8_t arduino_read_pin(uint8_t pin) {
+  return digitalRead(pin);
+}
+
+static void arduino_write_pin(uint8_t pin, uint8_t level) {
+  digitalWrite(pin, level);
+}
+
+static void arduino_set_pin_mode(uint8_t pin, uint8_t mode) {
+  pinMode(pin, mode);
+}
+
+static uint32_t arduino_read_clock() {
+  return millis();
+}
+
+static uint32_t arduino_read_clock_us() {
+  return micros();
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Port-wide access. Only offered for boards where the port macros
+// yield plain port numbers and input registers, otherwise every pin
+// is reported as having no port and will be read individually.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+#if defined(__AVR__) || defined(CONFIG_IDF_TARGET_ESP32) || defined(ez_switch_native)
+
+static uint8_t arduino_pin_port(uint8_t pin) {
+  uint8_t port = digitalPinToPort(pin);
+#if defined(__AVR__)
+  if (port == NOT_A_PIN) return ez_no_port;
+#endif
+  return port;
+}
+
+static uint8_t arduino_pin_bit(uint8_t pin) {
+  uint32_t mask = digitalPinToBitMask(pin);
+  uint8_t  bit  = 0;
+  while (mask > 1) {
+    mask >>= 1;
+    bit++;
+  }
+  return bit;
+}
+
+static uint32_t arduino_read_port(uint8_t port) {
+  return *portInputRegister(port);
+}
+
+static void arduino_write_port(uint8_t port, uint32_t set_mask, uint32_t clear_mask) {
+  ez_critical_begin();
+  auto out = portOutputRegister(port);
+  *out = (*out & ~clear_mask) | set_mask;  // the one register write
+  ez_critical_end();
+}
+
+#else
+
+static uint8_t arduino_pin_port(uint8_t pin) {
+  (void)pin;
+  return ez_no_port;
+}
+
+static uint8_t arduino_pin_bit(uint8_t pin) {
+  (void)pin;
+  return 0;
+}
+
+static uint32_t arduino_read_port(uint8_t port) {
+  (void)port;
+  return 0;
+}
+
+static void arduino_write_port(uint8_t port, uint32_t set_mask, uint32_t clear_mask) {
+  (void)port;
+  (void)set_mask;
+  (void)clear_mask;
+}
+
+#endif
+
+const ez_io_backend ez_arduino_io = {
+  arduino_read_pin,
+  arduino_write_pin,
+  arduino_set_pin_mode,
+  arduino_read_clock,
+  arduino_pin_port,
+  arduino_pin_bit,
+  arduino_read_port,
+  arduino_write_port,
+  arduino_read_clock_us
+};
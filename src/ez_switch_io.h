@@ -0,0 +1,93 @@
+// Arduino Switch Library - pluggable input/output and clock backend.
+//
+// Every pin and clock access made by the Switches class goes via an
+// 'ez_io_backend' so that the library can be driven by something other
+// than the Arduino core, for example a simulated GPIO/virtual clock
+// when the library is built and benchmarked natively on a host machine.
+//
+// Backends may also offer port-wide access, ie reading a whole GPIO
+// port's input register at once, used by Switches::read_all_switches.
+// A backend without port access returns 'ez_no_port' from pin_port.
+// Port-wide writes, setting and clearing any number of a port's output
+// pins in one register write, are used for output links (see
+// Switches::add_output_link); a backend without them gives a NULL
+// write_port.
+//
+// By default a Switches instance uses 'ez_arduino_io', which simply
+// calls digitalRead, digitalWrite, pinMode and millis. An alternative
+// backend may be established with Switches::set_io, but this must be
+// done BEFORE any switches are added or outputs linked.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_switch_io_h
+#define ez_switch_io_h
+#include <Arduino.h>
+
+#define ez_no_port          255     // pin has no port-wide register access
+
+// Width of a GPIO port register
+#if defined(__AVR__) || defined(ez_switch_native)
+typedef uint8_t  ez_port_mask_t;
+#else
+typedef uint32_t ez_port_mask_t;
+#endif
+
+struct ez_io_backend {
+  uint8_t  (*read_pin)    (uint8_t pin);                 // returns HIGH or LOW
+  void     (*write_pin)   (uint8_t pin, uint8_t level);  // sets pin HIGH or LOW
+  void     (*set_pin_mode)(uint8_t pin, uint8_t mode);   // INPUT, INPUT_PULLUP, OUTPUT, etc
+  uint32_t (*read_clock)  ();                            // elapsed time in millisecs
+  uint8_t  (*pin_port)    (uint8_t pin);                 // port the pin belongs to, or ez_no_port
+  uint8_t  (*pin_bit)     (uint8_t pin);                 // bit number of the pin within its port
+  uint32_t (*read_port)   (uint8_t port);                // input register value of the given port
+  void     (*write_port)  (uint8_t port, uint32_t set_mask, uint32_t clear_mask); // output register
+  uint32_t (*read_clock_us)();                           // elapsed time in microsecs, for metrics and traces
+};
+
+// Critical section, for data shared with interrupt service routines.
+// The interrupt state on entry is restored on exit, so these may also
+// be used within an ISR:
+//   AVR       - SREG saved and restored,
+//   Cortex-M  - PRIMASK saved and restored (interrupts of the calling
+//               core only, eg on the RP2040),
+//   ESP32     - a spinlock, which also excludes the other core, taken
+//               by portENTER_CRITICAL_SAFE from a task or an ISR,
+//   ESP8266   - the interrupt level saved and restored.
+// On other boards interrupts are simply disabled and re-enabled, so
+// these must not be used within an ISR, nor the library functions
+// documented as ISR safe (eg Switches::mark_switch_dirty) be called
+// from one.
+// Use begin/end as a pair within the same block.
+#if defined(__AVR__)
+#define ez_critical_isr_safe 1
+#define ez_critical_begin() uint8_t ez_saved_sreg = SREG; cli()
+#define ez_critical_end()   SREG = ez_saved_sreg
+#elif defined(__arm__) && defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M')
+#define ez_critical_isr_safe 1
+#define ez_critical_begin() uint32_t ez_saved_primask; \
+                            __asm__ volatile ("mrs %0, primask\n\tcpsid i" : "=r" (ez_saved_primask) :: "memory")
+#define ez_critical_end()   __asm__ volatile ("msr primask, %0" :: "r" (ez_saved_primask) : "memory")
+#elif defined(ARDUINO_ARCH_ESP32)
+#define ez_critical_isr_safe 1
+extern portMUX_TYPE ez_critical_mux;
+#define ez_critical_begin() portENTER_CRITICAL_SAFE(&ez_critical_mux)
+#define ez_critical_end()   portEXIT_CRITICAL_SAFE(&ez_critical_mux)
+#elif defined(ARDUINO_ARCH_ESP8266)
+#define ez_critical_isr_safe 1
+#define ez_critical_begin() uint32_t ez_saved_ps = xt_rsil(15)
+#define ez_critical_end()   xt_wsr_ps(ez_saved_ps)
+#else
+#define ez_critical_isr_safe 0
+#define ez_critical_begin() noInterrupts()
+#define ez_critical_end()   interrupts()
+#endif
+
+// The default backend, using the Arduino core functions.
+extern const ez_io_backend ez_arduino_io;
+
+#endif
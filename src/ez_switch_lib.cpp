@@ -9,6 +9,43 @@
 //   Sept 2022, version 3.01
 //     change of library variables to unsigned declarations, generally,
 //     eg byte to uint8_t, long unsigned int to uint32_t, etc
+//   Oct 2026, version 3.10
+//     all pin and clock access now made via a pluggable 'ez_io_backend'
+//     (see ez_switch_io.h), function 'set_io' added, allowing native
+//     (host) builds with a simulated GPIO/virtual clock
+//     addition of function 'read_all_switches' (overloaded), a batched
+//     scan of all switches reading each GPIO port register just once
+//     addition of function 'set_debounce_engine', offering a bit-sliced
+//     vertical counter debounce of all switches to read_all_switches
+//     addition of templates 'Static_switches<N>' (no heap) and
+//     'Fixed_switch<type, pin, circuit>' (compile time configured switch)
+//     addition of 'switch_events', a lock-free queue of switch events
+//     filled by the read functions, see ez_switch_events.h
+//     addition of interrupt driven scanning, functions 'mark_switch_dirty',
+//     'mark_pin_dirty', 'mark_all_dirty', 'scan_dirty_switches' and
+//     'switches_idle'
+//     addition of a debounce deadline scheduler for scan_dirty_switches
+//     and function 'next_deadline'
+//     addition of per switch debounce periods, 'set_debounce(switch_id,
+//     period)', and adaptive debounce, 'set_adaptive_debounce'
+//     addition of leading edge button switch modes, 'set_button_mode'
+//     switch control structure packed and no longer volatile, optional
+//     16 bit switch times (see ez_switch_config.h), and 'snapshot'
+//     addition of matrix keypad scanning, 'add_matrix'
+//     addition of input banks, switches on shift registers and GPIO
+//     expanders, 'add_bank', 'add_bank_switch' and 'refresh_banks'
+//     addition of switch handler dispatch, 'set_switch_handler',
+//     'set_event_handler' and 'poll'
+//     addition of multiple output links per switch, 'set_output_links'
+//     and 'add_output_link', with batched port writes
+//     addition of optional switch and scan metrics, 'print_metrics',
+//     'dump_metrics' and 'reset_metrics' (see ez_switch_config.h)
+//     addition of switch pin trace recording, 'set_trace' and
+//     'write_trace_header', see ez_switch_trace.h
+//     addition of 'Switch_scanner', scanning in its own task at a fixed
+//     period, see ez_switch_scanner.h
+//     addition of 'states' and 'pending', all switch states as bitmasks,
+//     and 'remove_switch', removed switches' slots being reused
 //
 // This example and code is in the public domain and
 // may be used without restriction and without warranty.
@@ -23,20 +60,84 @@
 
 Switches::Switches(uint8_t max_switches)
 {
-  // Establish the switch control structure (switches) of the size required.
+  // Establish the switch control structure (switches) of the size required,
+  // together with all other per switch data, as a single memory block.
   //
-  switches = (switch_control *)malloc(sizeof(*switches) * max_switches);
-  if (switches == NULL) {
+  void *storage = malloc(storage_size(max_switches));
+  if (storage == NULL) {
     // malloc failure
     Serial.begin(115200);
     Serial.println("!!Failure to acquire memory of required size - PROGRAM TERMINATED!!");
     Serial.flush();
     exit(1);
   }
+  assign_storage(max_switches, storage);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set up switch control structure in the given (static) memory block,
+// of at least storage_size(max_switches) bytes, suitably aligned.
+// Used by the Static_switches<N> template, so no heap is needed.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+Switches::Switches(uint8_t max_switches, void *storage)
+{
+  assign_storage(max_switches, storage);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Carve the given memory block into the per switch data areas and
+// initialise internal variables. The layout must be kept in step with
+// storage_size, widest alignment first.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::assign_storage(uint8_t max_switches, void *storage)
+{
+  uint8_t *next = (uint8_t *)storage;
+  // the switch control structure
+  switches = (switch_control *)next;
+  next    += sizeof(switch_control) * max_switches;
+  // the vertical counters for the bit-sliced debounce engine, 32 switches per counter
+  _vc   = (Vertical_debouncer<uint32_t> *)next;
+  next += sizeof(Vertical_debouncer<uint32_t>) * ez_switch_words(max_switches);
+  // the dirty bitmap for interrupt driven scanning
+  _dirty_bits = (volatile uint32_t *)next;
+  next += sizeof(uint32_t) * ez_switch_words(max_switches);
+  // the switch slots in use and switch state bitmaps, see states
+  _active_bits  = (uint32_t *)next;
+  _state_bits   = _active_bits + ez_switch_words(max_switches);
+  _pending_bits = _state_bits + ez_switch_words(max_switches);
+  next += sizeof(uint32_t) * ez_switch_words(max_switches) * 3;
+#if ez_switch_metrics
+  // switch metrics
+  metrics = (switch_metrics *)next;
+  next   += sizeof(switch_metrics) * max_switches;
+#endif
+  // the port group/bit of each switch, for batched reading of switches
+  _port_group = next;
+  _port_bit   = next + max_switches;
+  next += 2 * max_switches;
+  // the debounce deadline heap and each switch's position in it
+  _deadlines    = next;
+  _deadline_pos = next + max_switches;
 
   // Initialise private variables
   _num_entries  = 0;            // will be incremented each time a switch is added, up to _max_switches
   _max_switches = max_switches; // transfer to internal variable
+  for (uint8_t word = 0; word < ez_switch_words(max_switches); word++) {
+    _vc[word].reset(0);
+    _dirty_bits[word]   = 0;
+    _active_bits[word]  = 0;
+    _state_bits[word]   = 0;
+    _pending_bits[word] = 0;
+  }
+  _free_head = none_switched;
+  _num_free  = 0;
+  _num_deadlines = 0;
+  for (uint8_t sw = 0; sw < max_switches; sw++) _deadline_pos[sw] = no_deadline_pos;
+#if ez_switch_metrics
+  reset_metrics();
+#endif
 }
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -48,7 +149,16 @@ Switches::Switches(uint8_t max_switches)
 
 bool Switches::read_switch(uint8_t sw) {
   bool sw_status;
-  if (sw < 0 || sw >= _num_entries) return !switched; // out of range, slot 'sw' is not configured with a switch
+  if (!switch_active(sw)) return !switched; // out of range, slot 'sw' is not configured with a switch
+#if ez_switch_metrics
+  // a pass of read_switch calls over the switches is timed as a scan
+  uint32_t start_us = clock_us();
+  if (sw <= _last_read_id) {
+    if (_last_read_id != none_switched) record_scan(_pass_start_us, _pass_end_us);
+    _pass_start_us = start_us;
+  }
+  _last_read_id = sw;
+#endif
   if (switches[sw].switch_type == button_switch) {
     sw_status = read_button_switch(sw);
   } else {
@@ -56,14 +166,12 @@ bool Switches::read_switch(uint8_t sw) {
   }
   // now determine if switch has output pin associated and if switched
   // flip the output's status, ie HIGH->LOW, or LOW->HIGH
-  if (sw_status == switched && switches[sw].switch_out_pin > 0)
-  {
-    // flip the output level of associated switch output pin, if defined
-    bool status = switches[sw].switch_out_pin_status; // last status value of out_pin
-    status = HIGH - status;                           // flip the status value
-    switches[sw].switch_out_pin_status = status;      // update current status value
-    digitalWrite(switches[sw].switch_out_pin, status);// change status of linked pin
-  }
+  if (sw_status == switched) flip_linked_output(sw);
+  if (_num_pulsing > 0) end_pulses(_io->read_clock());
+  if (_outputs_pending) commit_outputs();
+#if ez_switch_metrics
+  _pass_end_us = clock_us();
+#endif
   return sw_status;
 }  // End of read_switch
 
@@ -77,29 +185,9 @@ bool Switches::read_switch(uint8_t sw) {
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 bool Switches::read_toggle_switch(uint8_t sw) {
-  uint8_t switch_pin_reading = digitalRead(switches[sw].switch_pin);  // test current state of toggle pin
-  if (switches[sw].switch_circuit_type == circuit_C2) {
-    // Need to invert HIGH/LOW if circuit design sets
-    // pin HIGH representing switch in off state.
-    // ie inititialised as INPUT_PULLUP
-    switch_pin_reading = !switch_pin_reading;
-  }
-  if (switch_pin_reading != switches[sw].switch_status && !switches[sw].switch_pending) {
-    // Switch change detected so start debounce cycle
-    switches[sw].switch_pending = true;
-    switches[sw].switch_db_start = millis();  // set start of debounce timing
-  }
-  if (switches[sw].switch_pending) {
-    // We are in the switch transition cycle so check if debounce period has elapsed
-    if (millis() - switches[sw].switch_db_start >= _debounce) {
-      // Debounce period elapsed so assume switch has settled down after transition
-      switches[sw].switch_status  = !switches[sw].switch_status;  // flip status
-      switches[sw].switch_pending = false;                        // cease transition cycle
-      last_switched_id = sw;   // indicates the last switch to have been processed by read function
-      return switched;
-    }
-  }
-  return !switched;
+  // Note that the 'on_value' will be LOW if circuit design sets pin HIGH
+  // representing switch in off state, ie inititialised as INPUT_PULLUP
+  return debounce_toggle(sw, read_contact(sw), _io->read_clock());  // test current state of toggle pin
 } // End of read_toggle_switch
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -115,24 +203,712 @@ bool Switches::read_toggle_switch(uint8_t sw) {
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 bool Switches::read_button_switch(uint8_t sw) {
-  uint8_t switch_pin_reading = digitalRead(switches[sw].switch_pin);
-  if (switch_pin_reading == switches[sw].switch_on_value) {
+  return debounce_button(sw, read_contact(sw), _io->read_clock());
+}  // End of read_button_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Read the given switch's contact, true if 'on', ie the pin reading
+// matches the switch's 'on_value', or for a matrix key, see read_key, or
+// for a bank switch, from its bank's inputs as last fetched.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::read_contact(uint8_t sw) {
+  if (matrix_key(sw)) return read_key(sw);
+  if (bank_switch(sw)) return read_bank_input(sw);
+  return _io->read_pin(switches[sw].switch_pin) == switches[sw].switch_on_value;
+} // End of read_contact
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Toggle switch debounce, given the switch's current reading ('on' or not,
+// ie already adjusted for circuit type) and the time of the reading.
+// Shared by read_toggle_switch and the batched read_all_switches scan.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::debounce_toggle(uint8_t sw, bool sw_on, uint32_t now) {
+  if (bounce != NULL) measure_bounce(sw, sw_on, now);
+  trace_reading(sw, sw_on);
+#if ez_switch_metrics
+  count_reading(sw, sw_on, now);
+#endif
+  if (sw_on != switches[sw].switch_status && !switches[sw].switch_pending) {
+    // Switch change detected so start debounce cycle
+    set_pending(sw, true);
+    switches[sw].switch_db_start = now;  // set start of debounce timing
+  }
+  if (switches[sw].switch_pending) {
+    // We are in the switch transition cycle so check if debounce period has elapsed
+    if (ez_elapsed(now, switches[sw].switch_db_start) >= switches[sw].switch_debounce) {
+      // Debounce period elapsed so assume switch has settled down after transition
+      set_status(sw, !switches[sw].switch_status);  // flip status
+      set_pending(sw, false);                       // cease transition cycle
+      if (bounce != NULL) adapt_debounce(sw);
+      report_switched(sw, switches[sw].switch_status == on ? toggle_on_event : toggle_off_event, now);
+      return switched;
+    }
+  }
+  return !switched;
+} // End of debounce_toggle
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Button switch debounce, given the switch's current reading ('on', ie
+// pressed, or not) and the time of the reading.
+// Shared by read_button_switch and the batched read_all_switches scan.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::debounce_button(uint8_t sw, bool sw_on, uint32_t now) {
+  if (bounce != NULL) measure_bounce(sw, sw_on, now);
+  trace_reading(sw, sw_on);
+#if ez_switch_metrics
+  count_reading(sw, sw_on, now);
+#endif
+  if (switches[sw].switch_mode != button_cycle_mode) return debounce_leading(sw, sw_on, now);
+  if (sw_on) {
     // Switch is pressed (ON), so start/restart debounce process
-    switches[sw].switch_pending = true;
-    switches[sw].switch_db_start   = millis();  // start elapse timing
-    return !switched;                           // now waiting for debounce to conclude
+    set_pending(sw, true);
+    switches[sw].switch_db_start   = now;   // start elapse timing
+    return !switched;                       // now waiting for debounce to conclude
   }
-  if (switches[sw].switch_pending && switch_pin_reading != switches[sw].switch_on_value) {
+  if (switches[sw].switch_pending) {
     // Switch was pressed, now released (OFF), so check if debounce time elapsed
-    if (millis() - switches[sw].switch_db_start >= _debounce) {
+    if (ez_elapsed(now, switches[sw].switch_db_start) >= switches[sw].switch_debounce) {
       // debounce time elapsed, so switch press cycle complete
-      switches[sw].switch_pending = false;
-      last_switched_id = sw;   // indicates the last switch to have been processed by read function
+      set_pending(sw, false);
+      if (bounce != NULL) adapt_debounce(sw);
+      report_switched(sw, button_cycle_event, now);
       return switched;
     }
   }
   return !switched;
-}  // End of read_button_switch
+}  // End of debounce_button
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Leading edge button switch debounce, see set_button_mode. The first
+// reading to differ from the button's state (pressed, ie pending, or
+// released) is taken at once, and further readings are then ignored for
+// the debounce period (the lockout) whilst the contacts bounce.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::debounce_leading(uint8_t sw, bool sw_on, uint32_t now) {
+  if (sw_on == switches[sw].switch_pending) return !switched;  // no change
+  if (ez_elapsed(now, switches[sw].switch_db_start) < switches[sw].switch_debounce) {
+    return !switched;  // locked out since last edge
+  }
+  set_pending(sw, sw_on);
+  switches[sw].switch_db_start = now;  // start of lockout
+  if (sw_on) {
+    report_switched(sw, button_press_event, now);
+    return switched;
+  }
+  if (bounce != NULL) adapt_debounce(sw);  // press cycle complete
+  if (switches[sw].switch_mode == button_press_release_mode) {
+    report_switched(sw, button_release_event, now);
+    return switched;
+  }
+  return !switched;
+}  // End of debounce_leading
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Record that the given switch has switched, both as the last switched
+// switch and, if the event queue has been established, as a queued event.
+// The event's kind is also noted for handler dispatch, see poll.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::report_switched(uint8_t sw, uint8_t event_kind, uint32_t now) {
+  last_switched_id = sw;   // indicates the last switch to have been processed by read function
+  if (switch_events.is_enabled()) switch_events.push(sw, event_kind, now);
+  if (_handlers != NULL) _handlers[sw].fired = event_kind;
+  _last_event_kind = event_kind;  // for flip_linked_output
+#if ez_switch_metrics
+  if (metrics[sw].events != 0xFFFF) metrics[sw].events++;
+#endif
+} // End of report_switched
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// If the given switch has a linked output then flip the output's
+// status, ie HIGH->LOW, or LOW->HIGH. Any output links of the switch
+// (see add_output_link) are also driven, given the switch's event.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::flip_linked_output(uint8_t sw) {
+  if (switches[sw].switch_out_pin > 0)
+  {
+    // flip the output level of associated switch output pin, if defined
+    bool status = switches[sw].switch_out_pin_status; // last status value of out_pin
+    status = HIGH - status;                           // flip the status value
+    switches[sw].switch_out_pin_status = status;      // update current status value
+    _io->write_pin(switches[sw].switch_out_pin, status); // change status of linked pin
+  }
+  if (_num_links > 0) drive_links(sw, _last_event_kind);
+} // End of flip_linked_output
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Batched read of ALL switches.
+// Rather than one digitalRead per switch, the input register of each GPIO
+// port having switches is read just once per scan (port groupings being
+// established by add_switch), circuit_C2 inversion applied as a mask,
+// and every switch then debounced, as per read_switch, from the port
+// values captured. Any linked outputs are processed as per read_switch.
+// Switches on pins for which the board has no port register access are
+// read individually.
+//
+// The function returns the number of switches that switched and records
+// them in 'switched_mask', one bit per switch_id (bit n of word n/32),
+// which must be at least ez_switch_words(max_switches) words long.
+// The parameterless version returns the switched bitmask directly, but
+// only for switch_ids 0-31 (all switches are still read).
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint8_t Switches::read_all_switches(uint32_t switched_mask[]) {
+  return scan_switches(switched_mask, ez_switch_words(_num_entries));
+} // End of read_all_switches
+
+uint32_t Switches::read_all_switches() {
+  uint32_t switched_mask;
+  scan_switches(&switched_mask, 1);
+  return switched_mask;
+} // End of read_all_switches
+
+uint8_t Switches::scan_switches(uint32_t switched_mask[], uint8_t mask_words) {
+  ez_port_mask_t port_value[ez_max_port_groups];
+  uint8_t num_switched = 0;
+  for (uint8_t word = 0; word < mask_words; word++) switched_mask[word] = 0;
+#if ez_switch_metrics
+  uint32_t start_us = clock_us();
+#endif
+  uint32_t now = _io->read_clock();
+  if (_num_pulsing > 0) end_pulses(now);
+  if (_engine == vertical_debounce) {
+    // vertical counters are only advanced once per sample interval
+    if (now - _vc_sample_time < _vc_interval) {
+      if (_outputs_pending) commit_outputs();
+      return 0;
+    }
+    _vc_sample_time = now;
+  }
+  // one register read per port, with any circuit_C2 pins inverted so
+  // that a set bit always means 'on'
+  for (uint8_t group = 0; group < _num_port_groups; group++) {
+    port_value[group] = (ez_port_mask_t)_io->read_port(_port_groups[group].port) ^ _port_groups[group].invert;
+  }
+  if (_matrix != NULL) scan_matrix();
+  refresh_banks();
+  if (_engine == vertical_debounce) {
+    num_switched = scan_vertical(port_value, now, switched_mask, mask_words);
+  } else {
+    for (uint8_t word = 0; word < ez_switch_words(_num_entries); word++) {
+      uint32_t active = _active_bits[word];  // removed switches skipped, see remove_switch
+      for (uint8_t sw = word * 32; active != 0; sw++, active >>= 1) {
+        if ((active & 1) == 0) continue;
+        if (process_switch(sw, sample_switch(sw, port_value), now) == switched) {
+          if (word < mask_words) switched_mask[word] |= (uint32_t)1 << (sw % 32);
+          num_switched++;
+        }
+      }
+    }
+  }
+  if (_outputs_pending) commit_outputs();  // one write per output port
+#if ez_switch_metrics
+  record_scan(start_us, clock_us());
+#endif
+  return num_switched;
+} // End of scan_switches
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Read all switches, as per read_all_switches, then call the handler of
+// each switch that switched, given the kind of its event (see
+// ez_switch_events.h), so replacing the read_switch/if/switch-case chain
+// of a sketch's loop() with one call, eg
+//   void start_pump(uint8_t switch_id, uint8_t event_kind, void *context) {...}
+//   ...
+//   my_switches.set_switch_handler(pump_button, start_pump);
+//   ...
+//   my_switches.poll();
+// Handlers are called after the scan, and after any linked outputs have
+// been flipped, so may themselves use the library's functions.
+// Returns the number of switches that switched.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint8_t Switches::poll() {
+  uint32_t switched_mask[ez_switch_words(none_switched)];
+  uint8_t  words = ez_switch_words(_num_entries);
+  uint8_t  num_switched = scan_switches(switched_mask, words);
+  if (num_switched == 0 || _handlers == NULL) return num_switched;
+  for (uint8_t word = 0; word < words; word++) {
+    uint32_t bits = switched_mask[word];
+    for (uint8_t sw = word * 32; bits != 0; sw++, bits >>= 1) {
+      if (bits & 1) dispatch(sw, _handlers[sw].fired);
+    }
+  }
+  return num_switched;
+} // End of poll
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Call the handler for the given switch's event - the switch's own
+// handler if it handles events of this kind, otherwise the handler set
+// for the event kind, if any.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::dispatch(uint8_t sw, uint8_t event_kind) {
+  handler_entry &entry = _handlers[sw];
+  if (entry.handler != NULL && (entry.kinds & ez_event_mask(event_kind))) {
+    entry.handler(sw, event_kind, entry.context);
+  } else if (event_kind >= toggle_on_event && event_kind <= button_release_event &&
+             _event_handlers[event_kind - 1].handler != NULL) {
+    _event_handlers[event_kind - 1].handler(sw, event_kind, _event_handlers[event_kind - 1].context);
+  }
+} // End of dispatch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set the handler called by poll when the given switch switches, for
+// events of the given kinds only, eg
+//   ez_event_mask(button_press_event) | ez_event_mask(button_release_event)
+// (all kinds by default), 'context' being passed to the handler as given.
+// A NULL handler removes the switch's handler.
+// Returns handler_success, or handler_failure if there is no such switch,
+// or no memory for the handler table (created on first use, one entry
+// per switch).
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::set_switch_handler(uint8_t switch_id, switch_handler handler,
+                                 void *context, uint8_t kinds) {
+  if (!switch_active(switch_id) || !assign_handlers()) return handler_failure;
+  _handlers[switch_id].handler = handler;
+  _handlers[switch_id].context = context;
+  _handlers[switch_id].kinds   = kinds;
+  return handler_success;
+} // End of set_switch_handler
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set the handler called by poll for events of the given kind from any
+// switch without a handler of its own for that kind, eg
+//   my_switches.set_event_handler(button_cycle_event, any_button);
+// A NULL handler removes the handler for that kind.
+// Returns handler_success, or handler_failure if no such event kind, or
+// no memory for the handler table.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::set_event_handler(uint8_t event_kind, switch_handler handler, void *context) {
+  if (event_kind < toggle_on_event || event_kind > button_release_event ||
+      !assign_handlers()) return handler_failure;
+  _event_handlers[event_kind - 1].handler = handler;
+  _event_handlers[event_kind - 1].context = context;
+  return handler_success;
+} // End of set_event_handler
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Create the handler table, one entry per switch slot, if not already
+// created. Returns false if there is no memory for it.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::assign_handlers() {
+  if (_handlers != NULL) return true;
+  _handlers = (handler_entry *)malloc(sizeof(handler_entry) * _max_switches);
+  if (_handlers == NULL) return false;
+  for (uint8_t sw = 0; sw < _max_switches; sw++) {
+    _handlers[sw].handler = NULL;
+    _handlers[sw].context = NULL;
+    _handlers[sw].kinds   = 0;
+    _handlers[sw].fired   = 0;
+  }
+  return true;
+} // End of assign_handlers
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Debounce the given switch from its current reading, processing any
+// linked output if switched, as per read_switch.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::process_switch(uint8_t sw, bool sw_on, uint32_t now) {
+  bool sw_status;
+  if (switches[sw].switch_type == button_switch) {
+    sw_status = debounce_button(sw, sw_on, now);
+  } else {
+    sw_status = debounce_toggle(sw, sw_on, now);
+  }
+  if (sw_status == switched) flip_linked_output(sw);
+  return sw_status;
+} // End of process_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Return the current reading ('on' or not) of the given switch, from the
+// port values captured for the scan, from its bank's inputs fetched for
+// the scan if a bank switch, from the matrix scan if a matrix key, or by
+// reading its pin directly if it has no port group.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::sample_switch(uint8_t sw, const ez_port_mask_t port_value[]) {
+  uint8_t group = _port_group[sw];
+  if (group < ez_max_port_groups) {
+    return (port_value[group] >> _port_bit[sw]) & 1;
+  }
+  if (group != ez_no_port) return read_bank_input(sw);
+  if (matrix_key(sw)) {
+    // from the matrix scan made for this scan
+    uint8_t key = sw - _matrix->first_id;
+    return (_matrix->sample[key / _matrix->num_cols] >> (key % _matrix->num_cols)) & 1;
+  }
+  return _io->read_pin(switches[sw].switch_pin) == switches[sw].switch_on_value;
+} // End of sample_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Bit-sliced (vertical counter) debounce of all switches, 32 at a time.
+// The switches' readings are packed one bit per switch and debounced
+// together with a few bitwise operations, see ez_vertical_debounce.h.
+// Only switches whose debounced state flips need further processing:
+//   toggle switches - status takes the new debounced state, switched,
+//   button switches - debounced 'on' starts the press cycle (pending),
+//                     debounced 'off' completes it, switched, or as
+//                     given by the switch's mode, see set_button_mode.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint8_t Switches::scan_vertical(const ez_port_mask_t port_value[], uint32_t now,
+                                uint32_t switched_mask[], uint8_t mask_words) {
+  uint8_t num_switched = 0;
+  for (uint8_t word = 0; word < ez_switch_words(_num_entries); word++) {
+    uint8_t  first = word * 32;
+    uint8_t  last  = (_num_entries - first > 32) ? first + 32 : _num_entries;
+    uint32_t sample = 0;
+    uint32_t active = _active_bits[word];
+    for (uint8_t sw = first; sw < last; sw++, active >>= 1) {
+      if ((active & 1) == 0) continue;  // removed, see remove_switch
+      bool sw_on = sample_switch(sw, port_value);
+      trace_reading(sw, sw_on);
+#if ez_switch_metrics
+      count_reading(sw, sw_on, now);
+#endif
+      if (sw_on) sample |= (uint32_t)1 << (sw - first);
+    }
+    uint32_t flips = _vc[word].update(sample);
+    for (uint8_t sw = first; flips != 0; sw++, flips >>= 1) {
+      if ((flips & 1) == 0) continue;
+      bool sw_on = (_vc[word].state >> (sw - first)) & 1;
+      if (switches[sw].switch_type == button_switch) {
+        set_pending(sw, sw_on);
+        switches[sw].switch_db_start = now;
+        if (switches[sw].switch_mode == button_cycle_mode) {
+          // pressed, press cycle completes when released
+          if (sw_on) continue;
+          report_switched(sw, button_cycle_event, now);
+        } else if (sw_on) {
+          report_switched(sw, button_press_event, now);
+        } else if (switches[sw].switch_mode == button_press_release_mode) {
+          report_switched(sw, button_release_event, now);
+        } else {
+          continue;  // release not reported
+        }
+      } else {
+        set_status(sw, sw_on);
+        report_switched(sw, sw_on ? toggle_on_event : toggle_off_event, now);
+      }
+      flip_linked_output(sw);
+      if (word < mask_words) switched_mask[word] |= (uint32_t)1 << (sw - first);
+      num_switched++;
+    }
+  }
+  return num_switched;
+} // End of scan_vertical
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Select the debounce engine used by read_all_switches:
+//   standard_debounce - each switch debounced individually, exactly as
+//                       per read_switch (the default),
+//   vertical_debounce - all switches debounced together, 32 at a time,
+//                       by bit-sliced vertical counters. A switch's new
+//                       state is reported once stable for the debounce
+//                       period, sampled every third of that period.
+//                       The global debounce period (set_debounce(period))
+//                       applies to every switch - per switch periods
+//                       and adaptive debounce are ignored by this engine.
+// Note that read_switch, read_toggle_switch and read_button_switch
+// always use the standard engine, so should not be mixed with
+// read_all_switches when the vertical engine is selected.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::set_debounce_engine(uint8_t engine) {
+  if (engine == vertical_debounce && _engine != vertical_debounce) {
+    // carry the switches' current states into the vertical counters
+    for (uint8_t word = 0; word < ez_switch_words(_num_entries); word++) {
+      uint32_t state = 0;
+      for (uint8_t sw = word * 32; sw < _num_entries && sw < word * 32 + 32; sw++) {
+        bool sw_on = (switches[sw].switch_type == button_switch) ? switches[sw].switch_pending
+                                                                 : switches[sw].switch_status;
+        if (sw_on && switch_active(sw)) state |= (uint32_t)1 << (sw % 32);
+      }
+      _vc[word].reset(state);
+    }
+    _vc_sample_time = _io->read_clock();
+  }
+  if (engine == standard_debounce || engine == vertical_debounce) _engine = engine;
+} // End of set_debounce_engine
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Interrupt driven scanning.
+// Rather than reading every switch on every pass of loop() just to
+// notice a first edge, pin change or external interrupt service routines
+// mark switches 'dirty' using:
+//   mark_switch_dirty(switch_id) - the given switch,
+//   mark_pin_dirty(pin)          - all switches on the given pin, or
+//   mark_all_dirty()             - all switches, eg for a single ISR
+//                                  shared by all switches.
+// scan_dirty_switches then reads only switches marked dirty since the
+// last scan and those in transition (pending) whose debounce deadline
+// has arrived, and switches_idle reports when there is nothing left to
+// scan, so that the sketch may sleep until the next interrupt, or,
+// using next_deadline, until the next debounce deadline.
+// All three mark functions are ISR safe on the boards so listed in
+// ez_switch_io.h (ez_critical_isr_safe). Every switch is marked dirty
+// when added so that its initial state is picked up by the first scan.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::mark_switch_dirty(uint8_t switch_id) {
+  if (!switch_active(switch_id)) return;
+  ez_critical_begin();
+  _dirty_bits[switch_id / 32] |= (uint32_t)1 << (switch_id % 32);
+  ez_critical_end();
+} // End of mark_switch_dirty
+
+void Switches::mark_pin_dirty(uint8_t pin) {
+  for (uint8_t sw = 0; sw < _num_entries; sw++) {
+    // a removed switch's switch_pin links the free list, see remove_switch
+    if (switch_active(sw) && switches[sw].switch_pin == pin && !bank_switch(sw)) mark_switch_dirty(sw);
+  }
+} // End of mark_pin_dirty
+
+void Switches::mark_all_dirty() {
+  for (uint8_t word = 0; word < ez_switch_words(_num_entries); word++) {
+    ez_critical_begin();
+    _dirty_bits[word] |= _active_bits[word];
+    ez_critical_end();
+  }
+} // End of mark_all_dirty
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Read, as per read_switch, only the dirty switches and the pending
+// switches whose debounce deadline has arrived. The clock is sampled
+// once per scan and pending switches are held in a min-heap ordered by
+// deadline, so only the expired ones are looked at. Held buttons are
+// not polled at all, their release marking them dirty.
+// Returns the number of switches that switched, recording them in
+// 'switched_mask' if given (see read_all_switches).
+// Input banks are fetched at every scan, switches on inputs that have
+// changed being marked dirty.
+// Note that the deadlines are maintained by this function, so it
+// should not be mixed with the other read functions.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint8_t Switches::scan_dirty_switches(uint32_t switched_mask[]) {
+  uint32_t work[ez_switch_words(none_switched)];
+  uint32_t dirty[ez_switch_words(none_switched)];
+  uint8_t  num_switched = 0;
+  uint8_t  words = ez_switch_words(_num_entries);
+#if ez_switch_metrics
+  uint32_t start_us = clock_us();
+#endif
+  uint32_t now   = _io->read_clock();
+  if (_num_pulsing > 0) end_pulses(now);
+  refresh_banks();
+  // switches marked dirty since the last scan
+  for (uint8_t word = 0; word < words; word++) {
+    if (switched_mask != NULL) switched_mask[word] = 0;
+    ez_critical_begin();
+    dirty[word] = _dirty_bits[word];
+    _dirty_bits[word] = 0;
+    ez_critical_end();
+    work[word] = dirty[word];
+  }
+  // plus those whose debounce deadline has arrived
+  while (_num_deadlines > 0 && (ez_time_diff_t)((ez_time_t)now - deadline_of(_deadlines[0])) >= 0) {
+    uint8_t sw = _deadlines[0];
+    remove_deadline(sw);
+    work[sw / 32] |= (uint32_t)1 << (sw % 32);
+  }
+  for (uint8_t word = 0; word < words; word++) {
+    uint32_t bits = work[word];
+    for (uint8_t sw = word * 32; bits != 0; sw++, bits >>= 1) {
+      if ((bits & 1) == 0) continue;
+      bool sw_on = read_contact(sw);
+      if (switches[sw].switch_type == button_switch && switches[sw].switch_mode == button_cycle_mode &&
+          switches[sw].switch_pending && !sw_on && (dirty[word] >> (sw % 32)) & 1) {
+        // a pressed button is not polled whilst held, so its contact was
+        // on until this interrupt, restart the debounce from now
+        switches[sw].switch_db_start = now;
+      }
+      if (process_switch(sw, sw_on, now) == switched) {
+        if (switched_mask != NULL) switched_mask[word] |= (uint32_t)1 << (sw % 32);
+        num_switched++;
+      }
+      // reschedule if in transition, the debounce start may have moved,
+      // but a held button can only complete its cycle on release, which
+      // will mark it dirty
+      remove_deadline(sw);
+      if (switches[sw].switch_type == button_switch && switches[sw].switch_mode != button_cycle_mode) {
+        // leading edge button, an edge ignored during the lockout is
+        // looked at again once the lockout ends
+        if (sw_on != switches[sw].switch_pending) insert_deadline(sw);
+      } else if (switches[sw].switch_pending) {
+        if (switches[sw].switch_type == toggle_switch || !sw_on) insert_deadline(sw);
+      } else if (switches[sw].switch_type == toggle_switch && sw_on != switches[sw].switch_status) {
+        // toggle switch's settled status no longer matches its contact
+        // (it moved back during debounce), so look again next scan
+        mark_switch_dirty(sw);
+      }
+    }
+  }
+  if (_outputs_pending) commit_outputs();
+#if ez_switch_metrics
+  record_scan(start_us, clock_us());
+#endif
+  return num_switched;
+} // End of scan_dirty_switches
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// True if no switch is dirty or awaiting its debounce deadline (held
+// buttons awaiting release excepted), and no output is pulsing, ie
+// scan_dirty_switches has nothing to do until the next interrupt. To
+// avoid missing an interrupt arriving between this test and going to
+// sleep, disable interrupts before the test and sleep with interrupts
+// re-enabled atomically, as the board's sleep support allows.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::switches_idle() {
+  if (_num_deadlines > 0 || _num_pulsing > 0) return false;
+  for (uint8_t word = 0; word < ez_switch_words(_num_entries); word++) {
+    if (_dirty_bits[word] != 0) return false;
+  }
+  return true;
+} // End of switches_idle
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Millisecs until scan_dirty_switches next needs to be called, so that a
+// scheduler may sleep or yield until then rather than busy-polling:
+//   0           - a switch is dirty, or its debounce deadline (or an
+//                 output pulse end, see add_output_link) has passed,
+//   no_deadline - nothing pending, so wait for the next interrupt,
+//   otherwise   - the time until the earliest debounce deadline or
+//                 output pulse end.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint32_t Switches::next_deadline() {
+  for (uint8_t word = 0; word < ez_switch_words(_num_entries); word++) {
+    if (_dirty_bits[word] != 0) return 0;
+  }
+  if (_num_deadlines == 0 && _num_pulsing == 0) return no_deadline;
+  uint32_t now  = _io->read_clock();
+  uint32_t next = no_deadline;
+  if (_num_deadlines > 0) {
+    ez_time_diff_t remaining = (ez_time_diff_t)(deadline_of(_deadlines[0]) - (ez_time_t)now);
+    next = remaining > 0 ? (uint32_t)remaining : 0;
+  }
+  for (uint8_t link = 0; link < _num_links; link++) {
+    if (_links[link].pulsing) {
+      // pulse ends also need a scan
+      ez_time_diff_t remaining = (ez_time_diff_t)(ez_time_t)(_links[link].pulse_start + _links[link].pulse_period - now);
+      if (remaining <= 0) return 0;
+      if ((uint32_t)remaining < next) next = remaining;
+    }
+  }
+  return next;
+} // End of next_deadline
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Debounce deadline min-heap. '_deadlines' holds the switch ids of all
+// pending switches, earliest deadline first ('_deadlines[0]'), and
+// '_deadline_pos' the position of each switch in the heap, or
+// no_deadline_pos. Deadlines are compared relative to each other so
+// that the millis() roll over is handled.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+ez_time_t Switches::deadline_of(uint8_t sw) {
+  return switches[sw].switch_db_start + switches[sw].switch_debounce;
+} // End of deadline_of
+
+void Switches::insert_deadline(uint8_t sw) {
+  uint8_t pos = _num_deadlines++;
+  _deadlines[pos]   = sw;
+  _deadline_pos[sw] = pos;
+  sift_deadline(pos);
+} // End of insert_deadline
+
+void Switches::remove_deadline(uint8_t sw) {
+  uint8_t pos = _deadline_pos[sw];
+  if (pos == no_deadline_pos) return;  // not in heap
+  _deadline_pos[sw] = no_deadline_pos;
+  _num_deadlines--;
+  if (pos == _num_deadlines) return;   // was the last entry
+  // move the last entry into the vacated position and restore heap order
+  uint8_t last = _deadlines[_num_deadlines];
+  _deadlines[pos]     = last;
+  _deadline_pos[last] = pos;
+  sift_deadline(pos);
+} // End of remove_deadline
+
+void Switches::sift_deadline(uint8_t pos) {
+  uint8_t sw = _deadlines[pos];
+  ez_time_t deadline = deadline_of(sw);
+  // up, towards the root, while earlier than the parent
+  while (pos > 0) {
+    uint8_t parent = (pos - 1) / 2;
+    if ((ez_time_diff_t)(deadline - deadline_of(_deadlines[parent])) >= 0) break;
+    _deadlines[pos] = _deadlines[parent];
+    _deadline_pos[_deadlines[pos]] = pos;
+    pos = parent;
+  }
+  // down, towards the leaves, while later than the earliest child
+  while (true) {
+    uint16_t child = 2 * (uint16_t)pos + 1;
+    if (child >= _num_deadlines) break;
+    if (child + 1 < _num_deadlines &&
+        (ez_time_diff_t)(deadline_of(_deadlines[child + 1]) - deadline_of(_deadlines[child])) < 0) child++;
+    if ((ez_time_diff_t)(deadline_of(_deadlines[child]) - deadline) >= 0) break;
+    _deadlines[pos] = _deadlines[child];
+    _deadline_pos[_deadlines[pos]] = pos;
+    pos = child;
+  }
+  _deadlines[pos]   = sw;
+  _deadline_pos[sw] = pos;
+} // End of sift_deadline
+
+// Restore the heap order after a change to the given switch's debounce
+// period, if it is awaiting its deadline.
+void Switches::reschedule(uint8_t sw) {
+  if (_deadline_pos[sw] == no_deadline_pos) return;
+  remove_deadline(sw);
+  insert_deadline(sw);
+} // End of reschedule
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Record which port group the given switch's pin belongs to for the
+// batched scan, adding a new group if its port is not yet known. If the
+// pin has no port register access, or all groups are in use, the switch
+// will be read individually.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::assign_port_group(uint8_t sw) {
+  uint8_t port  = _io->pin_port(switches[sw].switch_pin);
+  uint8_t group = ez_no_port;
+  if (port != ez_no_port) {
+    for (uint8_t g = 0; g < _num_port_groups; g++) {
+      if (_port_groups[g].port == port) group = g;
+    }
+    if (group == ez_no_port && _num_port_groups < ez_max_port_groups) {
+      // new port, so start a new group
+      group = _num_port_groups++;
+      _port_groups[group].port   = port;
+      _port_groups[group].invert = 0;
+    }
+  }
+  _port_group[sw] = group;
+  if (group != ez_no_port) {
+    _port_bit[sw] = _io->pin_bit(switches[sw].switch_pin);
+    if (switches[sw].switch_on_value == LOW) {
+      // circuit_C2, 'on' is represented by LOW so invert this pin's bit
+      _port_groups[group].invert |= (ez_port_mask_t)1 << _port_bit[sw];
+    } else {
+      // the pin may have been that of a removed circuit_C2 switch
+      _port_groups[group].invert &= ~((ez_port_mask_t)1 << _port_bit[sw]);
+    }
+  }
+} // End of assign_port_group
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 // Add given switch to switch control structure, but validate
@@ -153,49 +929,364 @@ int Switches::add_switch(uint8_t sw_type, uint8_t sw_pin, uint8_t circ_type) {
       (circ_type != circuit_C1 &&
        circ_type != circuit_C2 &&
        circ_type != circuit_C3)) return bad_params;  // bad paramters
-  if (_num_entries < _max_switches) {
-    // room to add another switch...initialise the switch's
-    // data depending on type of switch and circuit
-    switches[_num_entries].switch_type         = sw_type;
-    switches[_num_entries].switch_pin          = sw_pin;
-    switches[_num_entries].switch_circuit_type = circ_type;
-    switches[_num_entries].switch_pending      = false;
-    switches[_num_entries].switch_db_start     = 0;
-    // define what on means for this switch:
-    if (circ_type != circuit_C2) {
-      // circuit_C1 and circuit_C3 are used with pull down resistors
-      // if circuit_C1 (INPUT) then and external 10k ohm resistor needs to be fitted
-      // to the switch circuit, but if circuit_C3 (INPUT_PULLDOWN) then the resistor
-      // is internal to the microcontroller.
-      // Note that the 'on' state is represented by HIGH (3.3/5v)
-      switches[_num_entries].switch_on_value = HIGH;
+  int sw = take_slot();          // a removed switch's slot, else the next free slot
+  if (sw == add_failure) return add_failure;  // no room left to add another switch!
+  place_switch(sw, sw_type, sw_pin, circ_type);
+  return sw;                     // return 'switch_id' - given switch now added to switch control structure
+}  // End add_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Return the slot for a switch being added - the most recently
+// removed switch's slot (see remove_switch), else the next
+// never used slot - or add_failure if none.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::take_slot() {
+  if (_free_head != none_switched) {
+    uint8_t sw = _free_head;
+    _free_head = switches[sw].switch_pin;  // next removed slot
+    _num_free--;
+    return sw;
+  }
+  if (_num_entries < _max_switches) return _num_entries++;
+  return add_failure;
+} // End of take_slot
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set up the given slot as a switch on the given pin.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::place_switch(uint8_t sw, uint8_t sw_type, uint8_t sw_pin, uint8_t circ_type) {
+  init_switch(sw, sw_type, sw_pin, circ_type);
+  _io->set_pin_mode(sw_pin, circ_type);  // establish pin set up
+  assign_port_group(sw);         // for batched reading by read_all_switches
+  mark_switch_dirty(sw);         // initial state picked up by scan_dirty_switches
+} // End of place_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Remove the given switch. Its slot is passed over by all scans, and is
+// reused by the next switch added by add_switch or add_bank_switch, so
+// no memory is given back or reallocated and the switch_ids of other
+// switches are unchanged. Any output links of the switch are removed,
+// the numbers of later links dropping to close the gap, and its linked
+// outputs are left as they are. Its handler, adaptive debounce and
+// metrics are cleared. Matrix keys may not be removed.
+//
+// Return values are:
+//       0 remove_success - switch removed,
+//      -1 remove_failure - no such switch, or a matrix key.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::remove_switch(uint8_t switch_id) {
+  if (!switch_active(switch_id) || matrix_key(switch_id)) return remove_failure;
+  uint8_t  word = switch_id / 32;
+  uint32_t bit  = (uint32_t)1 << (switch_id % 32);
+  ez_critical_begin();           // the dirty bits may be set from ISRs
+  _active_bits[word] &= ~bit;
+  _dirty_bits[word]  &= ~bit;
+  ez_critical_end();
+  set_pending(switch_id, false);
+  _state_bits[word] &= ~bit;
+  remove_deadline(switch_id);
+  _vc[word].clear(bit);
+  switches[switch_id].switch_out_pin = 0;
+  // close up the switch's output links
+  uint8_t kept = 0;
+  for (uint8_t link = 0; link < _num_links; link++) {
+    if (_links[link].switch_id == switch_id) {
+      if (_links[link].pulsing) _num_pulsing--;
     } else {
-      // circuit_C2 (INPUT_PULLUP) with internal microcontroller pull up resistor
-      // Note that the 'on' state is represented by LOW (0v)
-      switches[_num_entries].switch_on_value = LOW;
+      _links[kept++] = _links[link];
     }
-    if (sw_type == button_switch) {
-      switches[_num_entries].switch_status = not_used;
-    } else {
-      switches[_num_entries].switch_status = !on;
+  }
+  _num_links = kept;
+  if (_handlers != NULL) {
+    _handlers[switch_id].handler = NULL;
+    _handlers[switch_id].context = NULL;
+    _handlers[switch_id].kinds   = 0;
+    _handlers[switch_id].fired   = 0;
+  }
+  if (bounce != NULL) bounce[switch_id].max_debounce = 0;
+#if ez_switch_metrics
+  metrics[switch_id].transitions  = 0;
+  metrics[switch_id].events       = 0;
+  metrics[switch_id].bounce_edges = 0;
+  metrics[switch_id].max_settle   = 0;
+#endif
+  if (last_switched_id == switch_id) last_switched_id = none_switched;
+  _port_group[switch_id] = ez_no_port;
+  // chain the slot onto the free list, through its switch_pin
+  switches[switch_id].switch_pin = _free_head;
+  _free_head = switch_id;
+  _num_free++;
+  return remove_success;
+} // End of remove_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Initialise the given switch's data depending on type of
+// switch and circuit, see add_switch and add_bank_switch.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::init_switch(uint8_t sw, uint8_t sw_type, uint8_t sw_pin, uint8_t circ_type) {
+  switches[sw].switch_type         = sw_type;
+  switches[sw].switch_pin          = sw_pin;
+  switches[sw].switch_circuit_type = circ_type;
+  set_pending(sw, false);
+  switches[sw].switch_db_start     = 0;
+  switches[sw].switch_debounce     = _debounce;
+  switches[sw].switch_mode         = button_cycle_mode;
+  // define what on means for this switch:
+  if (circ_type != circuit_C2) {
+    // circuit_C1 and circuit_C3 are used with pull down resistors
+    // if circuit_C1 (INPUT) then and external 10k ohm resistor needs to be fitted
+    // to the switch circuit, but if circuit_C3 (INPUT_PULLDOWN) then the resistor
+    // is internal to the microcontroller.
+    // Note that the 'on' state is represented by HIGH (3.3/5v)
+    switches[sw].switch_on_value = HIGH;
+  } else {
+    // circuit_C2 (INPUT_PULLUP) with internal microcontroller pull up resistor
+    // Note that the 'on' state is represented by LOW (0v)
+    switches[sw].switch_on_value = LOW;
+  }
+  set_status(sw, !on);
+  if (sw_type == button_switch) {
+    switches[sw].switch_status = not_used;
+  }
+  // ensure no mapping to an output pin until created explicitly
+  switches[sw].switch_out_pin        = 0;
+  switches[sw].switch_out_pin_status = LOW;  // set LOW unless explicitly changed
+  _active_bits[sw / 32] |= (uint32_t)1 << (sw % 32);  // in use
+} // End of init_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Add an input bank, ie a shift register chain or GPIO expander whose
+// inputs are fetched together in one bulk transfer, see ez_input_bank.h.
+// The bank must be ready for use, eg its 'begin' called, as its inputs
+// are fetched here. The bank must remain in scope, eg be global.
+// Switches are then added to the bank's inputs with add_bank_switch.
+//
+// Return values are:
+//    >= 0 the bank's 'bank_id', as given to add_bank_switch,
+//      -1 add_failure - ez_max_banks banks already added,
+//      -2 bad_params - the bank has no inputs, or too many.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::add_bank(Input_bank &bank) {
+  if (bank.num_inputs == 0 || bank.num_inputs > 8 * ez_max_bank_bytes) return bad_params;
+  if (_num_banks >= ez_max_banks) return add_failure;
+  bank.fetch();
+  _banks[_num_banks] = &bank;
+  return _num_banks++;
+} // End of add_bank
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Add a switch wired to the given input of the given bank, as per
+// add_switch, its switch_pin being its input number. 'circ_type' gives
+// what 'on' means - circuit_C2, LOW, for switches to ground with pull up
+// resistors, otherwise HIGH. Pull ups/downs are as fitted, or as
+// configured on the expander by the sketch, the bank's inputs not being
+// reconfigured here.
+// Bank switches are read from their bank's inputs as last fetched, which
+// read_all_switches and scan_dirty_switches do once per scan. If bank
+// switches are read with read_switch, call refresh_banks first, eg once
+// each time round loop().
+//
+// Return values are as per add_switch.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::add_bank_switch(uint8_t sw_type, uint8_t bank_id, uint8_t input, uint8_t circ_type) {
+  if ((sw_type != button_switch && sw_type != toggle_switch) ||
+      (circ_type != circuit_C1 &&
+       circ_type != circuit_C2 &&
+       circ_type != circuit_C3) ||
+      bank_id >= _num_banks || input >= _banks[bank_id]->num_inputs) return bad_params;
+  int sw = take_slot();
+  if (sw == add_failure) return add_failure;
+  init_switch(sw, sw_type, input, circ_type);
+  _port_group[sw] = ez_bank_group(bank_id);
+  mark_switch_dirty(sw);  // initial state picked up by scan_dirty_switches
+  return sw;
+} // End of add_bank_switch
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Fetch the inputs of every bank, one bulk transfer per bank, marking
+// dirty (see scan_dirty_switches) any bank switch whose input changed.
+// Called by read_all_switches and scan_dirty_switches at each scan.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::refresh_banks() {
+  uint8_t changed[ez_max_banks][ez_max_bank_bytes];
+  bool    any_changed = false;
+  for (uint8_t bank = 0; bank < _num_banks; bank++) {
+    uint8_t bytes = (_banks[bank]->num_inputs + 7) / 8;
+    for (uint8_t byte = 0; byte < bytes; byte++) changed[bank][byte] = _banks[bank]->bits[byte];
+    _banks[bank]->fetch();
+    for (uint8_t byte = 0; byte < bytes; byte++) {
+      changed[bank][byte] ^= _banks[bank]->bits[byte];
+      if (changed[bank][byte] != 0) any_changed = true;
+    }
+  }
+  if (!any_changed) return;
+  for (uint8_t sw = 0; sw < _num_entries; sw++) {
+    if (switch_active(sw) && bank_switch(sw)) {
+      uint8_t input = switches[sw].switch_pin;
+      if ((changed[_port_group[sw] - ez_bank_group(0)][input / 8] >> (input % 8)) & 1) mark_switch_dirty(sw);
     }
-    pinMode(sw_pin, circ_type);  // establish pin set up
-    // ensure no mapping to an output pin until created explicitly
-    switches[_num_entries].switch_out_pin        = 0;
-    switches[_num_entries].switch_out_pin_status = LOW;  // set LOW unless explicitly changed
+  }
+} // End of refresh_banks
 
-    _num_entries++;              // point to next free slot
-    return _num_entries - 1;     // return 'switch_id' - given switch now added to switch control structure
-  } else return add_failure;     // no room left to add another switch!
-}  // End add_switch
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Return the given bank switch's reading ('on' or not), from its bank's
+// inputs as last fetched.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::read_bank_input(uint8_t sw) {
+  const uint8_t *bits = _banks[_port_group[sw] - ez_bank_group(0)]->bits;
+  uint8_t input = switches[sw].switch_pin;
+  return ((bits[input / 8] >> (input % 8)) & 1) == switches[sw].switch_on_value;
+} // End of read_bank_input
+
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Add a matrix keypad of 'num_rows' x 'num_cols' keys, all of type
+// 'sw_type', one per instance. Keys are wired between a row and a column,
+// rows with internal pull up resistors, so no other components are
+// needed beyond (optional) diodes, cathode to column.
+// Each key is added as a switch, as per add_switch, with switch_ids in
+// row order from the id returned, ie key (row, col) has switch_id
+//   first_id + row * num_cols + col,
+// its switch_pin being its row pin. Keys are debounced and linked to
+// outputs exactly as other switches.
+// read_all_switches scans the whole matrix once per call, driving each
+// column LOW in turn and reading the rows, a register read per port. The
+// pin arrays must remain in scope, eg be global.
+// Without diodes ('diodes' false), pressing three keys at the corners of
+// a rectangle makes the fourth appear pressed (ghosting). The keys of any
+// such rectangle then keep their previous readings until it is broken.
+// read_switch, and scan_dirty_switches, read a single key by driving its
+// column only, so without ghost suppression.
+//
+// Return values are:
+//    >= 0 the switch_id of the key at row 0, column 0,
+//      -1 add_failure - not enough free slots for the keys, no memory,
+//         or a matrix has already been added,
+//      -2 bad_params - given paramter(s) not valid.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::add_matrix(const uint8_t row_pins[], uint8_t num_rows,
+                         const uint8_t col_pins[], uint8_t num_cols,
+                         uint8_t sw_type, bool diodes) {
+  if (row_pins == NULL || col_pins == NULL ||
+      num_rows == 0 || num_rows > ez_max_matrix_lines ||
+      num_cols == 0 || num_cols > ez_max_matrix_lines ||
+      (sw_type != button_switch && sw_type != toggle_switch)) return bad_params;
+  if (_matrix != NULL || (uint16_t)num_rows * num_cols > _max_switches - _num_entries) return add_failure;
+  key_matrix *matrix = (key_matrix *)malloc(sizeof(key_matrix));
+  if (matrix == NULL) return add_failure;
+  matrix->row_pins   = row_pins;
+  matrix->col_pins   = col_pins;
+  matrix->num_rows   = num_rows;
+  matrix->num_cols   = num_cols;
+  matrix->first_id   = _num_entries;
+  matrix->diodes     = diodes;
+  matrix->row_groups = 0;
+  for (uint8_t col = 0; col < num_cols; col++) _io->set_pin_mode(col_pins[col], INPUT);  // undriven
+  for (uint8_t row = 0; row < num_rows; row++) {
+    matrix->sample[row] = 0;
+    for (uint8_t col = 0; col < num_cols; col++) {
+      uint8_t sw = _num_entries++;  // keys take consecutive never used slots
+      place_switch(sw, sw_type, row_pins[row], circuit_C2);
+      if (col == 0) {
+        // the row pin's port group, for the matrix scan
+        matrix->row_group[row] = _port_group[sw];
+        matrix->row_bit[row]   = _port_bit[sw];
+        if (_port_group[sw] != ez_no_port) matrix->row_groups |= (uint16_t)1 << _port_group[sw];
+      }
+      _port_group[sw] = ez_no_port;  // read by the matrix scan, not from its row's port
+    }
+  }
+  matrix->num_keys = num_rows * num_cols;
+  _matrix = matrix;
+  return matrix->first_id;
+} // End of add_matrix
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Matrix scan, made once per read_all_switches scan. Each column is
+// driven LOW in turn, the row ports read once each, and the keys of that
+// column sampled, set meaning 'on' (pressed, or on for toggle keys).
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::scan_matrix() {
+  ez_port_mask_t port_value[ez_max_port_groups];
+  for (uint8_t row = 0; row < _matrix->num_rows; row++) _matrix->sample[row] = 0;
+  for (uint8_t col = 0; col < _matrix->num_cols; col++) {
+    uint8_t col_pin = _matrix->col_pins[col];
+    _io->set_pin_mode(col_pin, OUTPUT);
+    _io->write_pin(col_pin, LOW);
+    for (uint8_t group = 0; group < _num_port_groups; group++) {
+      if ((_matrix->row_groups >> group) & 1) {
+        port_value[group] = (ez_port_mask_t)_io->read_port(_port_groups[group].port) ^ _port_groups[group].invert;
+      }
+    }
+    for (uint8_t row = 0; row < _matrix->num_rows; row++) {
+      uint8_t group = _matrix->row_group[row];
+      bool key_on = (group != ez_no_port) ? (port_value[group] >> _matrix->row_bit[row]) & 1
+                                          : _io->read_pin(_matrix->row_pins[row]) == LOW;
+      if (key_on) _matrix->sample[row] |= (uint16_t)1 << col;
+    }
+    _io->set_pin_mode(col_pin, INPUT);  // release the column
+  }
+  if (!_matrix->diodes) suppress_ghosts();
+} // End of scan_matrix
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Ghost suppression for matrices without diodes. A key is ambiguous if
+// it is a corner of a rectangle of four keys that all read 'on', as any
+// one of them may be a ghost of the other three. Ambiguous keys are given
+// their previous reading, ie their debounced state, instead.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::suppress_ghosts() {
+  uint16_t ambiguous[ez_max_matrix_lines];
+  for (uint8_t row = 0; row < _matrix->num_rows; row++) {
+    ambiguous[row] = 0;
+    for (uint8_t other = 0; other < _matrix->num_rows; other++) {
+      uint16_t shared = _matrix->sample[row] & _matrix->sample[other];  // columns 'on' in both rows
+      if (other != row && (shared & (shared - 1)) != 0) ambiguous[row] |= shared;  // two or more
+    }
+  }
+  for (uint8_t row = 0; row < _matrix->num_rows; row++) {
+    for (uint8_t col = 0; ambiguous[row] >> col != 0; col++) {
+      if (((ambiguous[row] >> col) & 1) == 0) continue;
+      uint8_t sw = _matrix->first_id + row * _matrix->num_cols + col;
+      bool held = (switches[sw].switch_type == toggle_switch) ? switches[sw].switch_status
+                                                              : switches[sw].switch_pending;
+      if (held) _matrix->sample[row] |= (uint16_t)1 << col;
+      else      _matrix->sample[row] &= ~((uint16_t)1 << col);
+    }
+  }
+} // End of suppress_ghosts
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Read a single matrix key, driving its column only.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+bool Switches::read_key(uint8_t sw) {
+  uint8_t key     = sw - _matrix->first_id;
+  uint8_t col_pin = _matrix->col_pins[key % _matrix->num_cols];
+  _io->set_pin_mode(col_pin, OUTPUT);
+  _io->write_pin(col_pin, LOW);
+  bool key_on = _io->read_pin(switches[sw].switch_pin) == LOW;
+  _io->set_pin_mode(col_pin, INPUT);
+  return key_on;
+} // End of read_key
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 // Link or delink the given switch to the given digital pin as an output
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 int Switches::link_switch_to_output(uint8_t switch_id, uint8_t output_pin, bool HorL) {
-  if (switch_id > _num_entries) {
+  if (!switch_active(switch_id)) {
     return link_failure; // no such switch
   }
   if (output_pin == 0) {
@@ -205,42 +1296,387 @@ int Switches::link_switch_to_output(uint8_t switch_id, uint8_t output_pin, bool
       return link_failure;
     }
     // set existing pin to level required state before clearing the link
-    digitalWrite(switches[switch_id].switch_out_pin, HorL);
+    _io->write_pin(switches[switch_id].switch_out_pin, HorL);
   } else {
     // initialise given output pin
-    pinMode(output_pin, OUTPUT);
-    digitalWrite(output_pin, HorL); // set to param value until switched
+    _io->set_pin_mode(output_pin, OUTPUT);
+    _io->write_pin(output_pin, HorL); // set to param value until switched
   }
   switches[switch_id].switch_out_pin        = output_pin;
   switches[switch_id].switch_out_pin_status = HorL;
   return link_success;           // success
 }
 
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Establish storage for output links, see add_output_link, eg
+//   Switches::output_link my_links[8];
+//   my_switches.set_output_links(my_links, 8);
+// Any links previously added are discarded.
+// Returns link_success, or link_failure if no storage given.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::set_output_links(output_link links[], uint8_t capacity) {
+  if (links == NULL || capacity == 0) return link_failure;
+  _links           = links;
+  _link_capacity   = capacity;
+  _num_links       = 0;
+  _num_pulsing     = 0;
+  _num_out_ports   = 0;
+  _outputs_pending = false;
+  return link_success;
+} // End of set_output_links
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Link the given switch to the given output pin, as well as any output
+// linked by link_switch_to_output. A switch may have any number of
+// links, as storage established by set_output_links allows. 'action'
+// is what the output does when the switch switches:
+//   link_toggle - flipped, on->off or off->on,
+//   link_follow - follows the switch, on whilst a toggle switch is on,
+//                 or whilst a button switch is pressed, for buttons in
+//                 button_press_release_mode (see set_button_mode),
+//                 otherwise flipped as link_toggle,
+//   link_pulse  - on for 'pulse_period' millisecs, restarted if
+//                 switched again before it ends.
+// 'on_level' gives the output's polarity, the level when 'on', HIGH or
+// LOW. The output is set to 'off' here.
+// Outputs changed by a read function call are written together once
+// the call's reading is done, a single register write per GPIO port
+// (pins without port access being written individually), so outputs
+// switching together change together. Pulses are ended by the read
+// functions, so must be called for the pulse period to be kept.
+//
+// Return values are:
+//    >= 0 the link's number,
+//      -1 link_failure - no such switch, bad action or pulse period, or
+//         link storage full or not established.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::add_output_link(uint8_t switch_id, uint8_t output_pin, uint8_t action,
+                              bool on_level, uint16_t pulse_period) {
+  if (!switch_active(switch_id) || _num_links >= _link_capacity ||
+      action > link_pulse || (action == link_pulse && pulse_period == 0)) return link_failure;
+  output_link &link = _links[_num_links];
+  link.switch_id    = switch_id;
+  link.pin          = output_pin;
+  link.action       = action;
+  link.active_low   = (on_level == LOW);
+  link.state        = false;
+  link.pulsing      = false;
+  link.pulse_period = pulse_period;
+  link.pulse_start  = 0;
+  // the pin's output port, for batched writes
+  uint8_t port = _io->pin_port(output_pin);
+  link.out_group = ez_no_port;
+  if (port != ez_no_port && _io->write_port != NULL) {
+    for (uint8_t g = 0; g < _num_out_ports; g++) {
+      if (_out_ports[g].port == port) link.out_group = g;
+    }
+    if (link.out_group == ez_no_port && _num_out_ports < ez_max_out_ports) {
+      // new port
+      link.out_group = _num_out_ports++;
+      _out_ports[link.out_group].port  = port;
+      _out_ports[link.out_group].set   = 0;
+      _out_ports[link.out_group].clear = 0;
+    }
+    link.out_bit = _io->pin_bit(output_pin);
+  }
+  _io->set_pin_mode(output_pin, OUTPUT);
+  _io->write_pin(output_pin, !on_level);  // off until switched
+  return _num_links++;
+} // End of add_output_link
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Drive the output links of the given switch, which has switched with
+// an event of the given kind.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::drive_links(uint8_t sw, uint8_t event_kind) {
+  for (uint8_t l = 0; l < _num_links; l++) {
+    output_link &link = _links[l];
+    if (link.switch_id != sw) continue;
+    if (link.action == link_pulse) {
+      set_link(link, true);
+      link.pulse_start = _io->read_clock();
+      if (!link.pulsing) {
+        link.pulsing = true;
+        _num_pulsing++;
+      }
+    } else if (link.action == link_follow && (event_kind == toggle_on_event ||
+               (event_kind == button_press_event && switches[sw].switch_mode == button_press_release_mode))) {
+      set_link(link, true);
+    } else if (link.action == link_follow && (event_kind == toggle_off_event ||
+                                               event_kind == button_release_event)) {
+      set_link(link, false);
+    } else {
+      set_link(link, !link.state);  // link_toggle, or follow of a button reported once per press
+    }
+  }
+} // End of drive_links
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set the given link's output 'on' or not, gathering the change into its
+// port's set/clear masks for commit_outputs, or writing it directly if
+// it has no port.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::set_link(output_link &link, bool link_on) {
+  link.state = link_on;
+  bool level = link_on != link.active_low;
+  if (link.out_group == ez_no_port) {
+    _io->write_pin(link.pin, level);
+    return;
+  }
+  out_port &port = _out_ports[link.out_group];
+  ez_port_mask_t bit = (ez_port_mask_t)1 << link.out_bit;
+  if (level == HIGH) {
+    port.set   |= bit;
+    port.clear &= ~bit;
+  } else {
+    port.clear |= bit;
+    port.set   &= ~bit;
+  }
+  _outputs_pending = true;
+} // End of set_link
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// End any output pulses whose period is up.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::end_pulses(uint32_t now) {
+  for (uint8_t l = 0; l < _num_links; l++) {
+    output_link &link = _links[l];
+    if (link.pulsing && ez_elapsed(now, link.pulse_start) >= link.pulse_period) {
+      set_link(link, false);
+      link.pulsing = false;
+      _num_pulsing--;
+    }
+  }
+} // End of end_pulses
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Write the output changes gathered by set_link, one register write per
+// output port changed.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::commit_outputs() {
+  for (uint8_t g = 0; g < _num_out_ports; g++) {
+    if ((_out_ports[g].set | _out_ports[g].clear) != 0) {
+      _io->write_port(_out_ports[g].port, _out_ports[g].set, _out_ports[g].clear);
+      _out_ports[g].set   = 0;
+      _out_ports[g].clear = 0;
+    }
+  }
+  _outputs_pending = false;
+} // End of commit_outputs
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Copy the states of all switches, one bit per switch_id (bit n of word
+// n/32), into 'state_mask', which must have ez_switch_words(max_switches)
+// words - a bit is set for each toggle switch that is on. Buttons are
+// never set, a pressed button being pending, see pending. Bits of
+// removed or never added switches are clear. Takes one copy per 32
+// switches, the bits being kept up to date as switches are read.
+// The version without parameters returns switch_ids 0-31 only.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::states(uint32_t state_mask[]) {
+  for (uint8_t word = 0; word < ez_switch_words(_max_switches); word++) state_mask[word] = _state_bits[word];
+} // End of states
+
+uint32_t Switches::states() {
+  return _max_switches > 0 ? _state_bits[0] : 0;
+} // End of states
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// As states, but a bit is set for each switch pending, ie switch_pending
+// is true - a toggle switch in debounce, or a button switch pressed (in
+// debounce or held).
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::pending(uint32_t pending_mask[]) {
+  for (uint8_t word = 0; word < ez_switch_words(_max_switches); word++) pending_mask[word] = _pending_bits[word];
+} // End of pending
+
+uint32_t Switches::pending() {
+  return _max_switches > 0 ? _pending_bits[0] : 0;
+} // End of pending
+
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 // Return the number of slots left unused
 // in the switch control structure.
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 int Switches::num_free_switch_slots() {
-  return _max_switches - _num_entries;
+  return _max_switches - _num_entries + _num_free;  // never used slots plus removed switches' slots
 } // End num_free_switch_slots
 
-// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
-// Set debounce period (milliseconds).
-// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set the default debounce period (milliseconds), given to switches
+// added later and to those already added that are still at the
+// previous default. Switches given their own period by
+// set_debounce(switch_id, period), or under adaptive debounce, keep
+// theirs (unless their own period equals the previous default). The
+// vertical debounce engine always uses this period.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 void Switches::set_debounce(uint16_t period) {
-  if (period >= 0)  _debounce = period;
+  uint16_t previous = _debounce;
+  _debounce = period;
+  // sample interval for the vertical debounce engine, such that a
+  // change is reported once stable for the debounce period
+  _vc_interval = (_debounce + vertical_samples - 2) / (vertical_samples - 1);
+  for (uint8_t sw = 0; sw < _num_entries; sw++) {
+    if (!switch_active(sw) || switches[sw].switch_debounce != previous) continue;
+    if (bounce != NULL && bounce[sw].max_debounce != 0) continue;  // adaptive
+    set_debounce(sw, _debounce);
+  }
 }  // End set_debounce
 
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set debounce period (milliseconds) of the given switch only, eg a
+// short period for a clean button and a longer one for a bouncy toggle.
+// If the switch is under adaptive debounce the period is kept within
+// the adaptive bounds.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::set_debounce(uint8_t switch_id, uint16_t period) {
+  if (!switch_active(switch_id)) return;  // no such switch
+  if (bounce != NULL && bounce[switch_id].max_debounce != 0) {
+    if (period < bounce[switch_id].min_debounce) period = bounce[switch_id].min_debounce;
+    if (period > bounce[switch_id].max_debounce) period = bounce[switch_id].max_debounce;
+  }
+  switches[switch_id].switch_debounce = period;
+  reschedule(switch_id);  // deadline may have moved, see scan_dirty_switches
+}  // End set_debounce
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Set when the given button switch is reported as switched:
+//   button_cycle_mode         - once pressed AND released, and the
+//                               debounce period has elapsed since the
+//                               last 'on' reading (the default),
+//   button_press_mode         - as soon as pressed, or
+//   button_press_release_mode - as soon as pressed and again as soon
+//                               as released.
+// In the two leading edge modes the first changed reading is taken at
+// once, then further readings are ignored for the debounce period (the
+// lockout) whilst the contacts bounce, so response time no longer
+// includes the press duration or the debounce period. Events queued
+// are button_press_event and button_release_event, and any linked
+// output is flipped on each reported edge, so follows the button in
+// button_press_release_mode. button_is_pressed reports the button as
+// pressed from the press edge until the release edge.
+//
+// Return values are:
+//    mode_success - mode set, the button's press cycle is reset, or
+//    mode_failure - no such button switch, or mode not valid.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::set_button_mode(uint8_t switch_id, uint8_t mode) {
+  if (!switch_active(switch_id) || switches[switch_id].switch_type != button_switch) return mode_failure;
+  if (mode != button_cycle_mode && mode != button_press_mode && mode != button_press_release_mode) return mode_failure;
+  switches[switch_id].switch_mode     = mode;
+  set_pending(switch_id, false);
+  switches[switch_id].switch_db_start = _io->read_clock() - switches[switch_id].switch_debounce;  // no lockout
+  remove_deadline(switch_id);
+  mark_switch_dirty(switch_id);  // current state picked up by scan_dirty_switches
+  return mode_success;
+} // End of set_button_mode
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Adaptive debounce of the given switch.
+// The switch's bounce is measured on every read: edges (changes of
+// reading) closer together than its debounce period form a burst, and
+// the time from the first to the last edge of a burst is its settle
+// time. At the end of each switch cycle the debounce period is tuned to
+// twice the recent peak settle time, plus a millisec for the reading
+// interval, kept within 'min_period' and 'max_period'. The peak follows
+// a worn switch's longer bounce at once but decays only slowly
+// (by an eighth) for shorter ones.
+// A 'max_period' of 0 ends adaptation, leaving the period as it is.
+// Measurements are kept in 'bounce[switch_id]', the memory for which is
+// created on the first call.
+// Note that adaptive debounce applies to the standard debounce engine
+// only, see set_debounce_engine.
+//
+// Return values are:
+//    adaptive_success - adaptive debounce established/ended, or
+//    adaptive_failure - no such switch, bad bounds or no memory.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switches::set_adaptive_debounce(uint8_t switch_id, uint16_t min_period, uint16_t max_period) {
+  if (!switch_active(switch_id) || min_period > max_period) return adaptive_failure;
+  if (bounce == NULL) {
+    if (max_period == 0) return adaptive_success;  // nothing to end
+    bounce = (bounce_stats *)malloc(sizeof(bounce_stats) * _max_switches);
+    if (bounce == NULL) return adaptive_failure;
+    for (uint8_t sw = 0; sw < _max_switches; sw++) bounce[sw].max_debounce = 0;
+  }
+  bounce_stats &b = bounce[switch_id];
+  b.max_debounce = 0;  // not adaptive whilst being set up
+  if (max_period == 0) return adaptive_success;
+  b.last_settle = 0;
+  b.last_edges  = 0;
+  b.max_edges   = 0;
+  b.edges       = 0;
+  b.last_on     = (switches[switch_id].switch_type == toggle_switch) ? switches[switch_id].switch_status : !on;
+  b.min_debounce = min_period;
+  b.max_debounce = max_period;
+  set_debounce(switch_id, switches[switch_id].switch_debounce);  // bring within bounds
+  b.settle_peak = switches[switch_id].switch_debounce / 2;       // start from the current period
+  return adaptive_success;
+} // End of set_adaptive_debounce
+
+// Record any edge in the given switch's readings.
+void Switches::measure_bounce(uint8_t sw, bool sw_on, uint32_t now) {
+  bounce_stats &b = bounce[sw];
+  if (b.max_debounce == 0 || sw_on == b.last_on) return;  // not adaptive, or no edge
+  b.last_on = sw_on;
+  if (b.edges > 0 && ez_elapsed(now, b.last_edge) >= switches[sw].switch_debounce) {
+    // too long since the last edge for this to be bounce, so a new burst
+    end_burst(sw);
+  }
+  if (b.edges == 0) b.burst_start = now;
+  if (b.edges < 255) b.edges++;
+  b.last_edge = now;
+} // End of measure_bounce
+
+// Fold the given switch's current burst of edges into its settle peak.
+void Switches::end_burst(uint8_t sw) {
+  bounce_stats &b = bounce[sw];
+  if (b.edges == 0) return;
+  uint32_t settle = ez_elapsed(b.last_edge, b.burst_start);
+  b.last_settle = (settle > 0xFFFF) ? 0xFFFF : settle;
+  b.last_edges  = b.edges;
+  if (b.edges > b.max_edges) b.max_edges = b.edges;
+  b.edges = 0;
+  if (b.last_settle >= b.settle_peak) {
+    b.settle_peak = b.last_settle;                               // bouncier, follow at once
+  } else {
+    b.settle_peak -= (b.settle_peak - b.last_settle + 7) / 8;    // cleaner, decay slowly
+  }
+} // End of end_burst
+
+// Tune the given switch's debounce period at the end of a switch cycle.
+void Switches::adapt_debounce(uint8_t sw) {
+  bounce_stats &b = bounce[sw];
+  if (b.max_debounce == 0) return;
+  end_burst(sw);
+  uint32_t period = 2 * (uint32_t)b.settle_peak + 1;
+  if (period > b.max_debounce) period = b.max_debounce;
+  if (period < b.min_debounce) period = b.min_debounce;
+  switches[sw].switch_debounce = period;
+} // End of adapt_debounce
+
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 // % reset the given switch to its
 // % non-pending (non-transition) state
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 void Switches::reset_switch(uint8_t switch_id) {
-  if (switch_id < _num_entries - 1) {
-    switches[switch_id].switch_pending  = false;
+  if (switch_active(switch_id)) {
+    set_pending(switch_id, false);
+    remove_deadline(switch_id);  // no longer in transition, see scan_dirty_switches
   }
 }
 
@@ -251,7 +1687,7 @@ void Switches::reset_switch(uint8_t switch_id) {
 
 void Switches::reset_switches() {
   for (uint8_t switch_id = 0; switch_id < _num_entries; switch_id++) {
-    switches[switch_id].switch_pending  = false;
+    reset_switch(switch_id);
   }
 }
 
@@ -271,7 +1707,7 @@ void Switches::reset_switches() {
 
 bool Switches::button_is_pressed(uint8_t switch_id, bool process_link) {
   // check switch is declared
-  if (switch_id < _num_entries) {
+  if (switch_active(switch_id)) {
     // check if switch is a button switch
     if (switches[switch_id].switch_type == button_switch) {
       // all checks done, read the switch
@@ -311,12 +1747,226 @@ bool Switches::button_is_pressed(uint8_t switch_id) {
   return button_is_pressed(switch_id, false);
 }
 
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Take a consistent copy of the given switch's control data.
+// The switch control structure is not volatile, so where switches are
+// read (and so updated) in an ISR, the main code should look at a
+// switch's data via a snapshot rather than directly. The copy is taken
+// with interrupts disabled, so is never part way through an update by
+// an ISR on the same core. It is NOT consistent with updates made on
+// another core, eg by a Switch_scanner task, whose switch states should
+// instead be taken by Switch_scanner::read_states.
+// Returns false if there is no such switch.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switches::snapshot(uint8_t switch_id, switch_control &copy) {
+  if (!switch_active(switch_id)) return false;  // no such switch
+  ez_critical_begin();
+  ez_memory_barrier();   // entry reread, not taken from registers
+  copy = switches[switch_id];
+  ez_memory_barrier();
+  ez_critical_end();
+  return true;
+} // End of snapshot
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Attach the given trace recorder (see ez_switch_trace.h), starting a new
+// trace, or detach with NULL. The recorder then records the transitions
+// of its chosen switches seen by all read functions.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::set_trace(Switch_trace *trace) {
+  if (trace != NULL) trace->start(clock_us());
+  _trace = trace;
+} // End of set_trace
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Write the trace header, describing the switches, to the given stream,
+// before any of the trace is drained to it. See ez_switch_trace.h for the
+// format.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+static void put_le(Print &out, uint32_t value, uint8_t bytes) {
+  uint8_t buffer[4];
+  for (uint8_t b = 0; b < bytes; b++) buffer[b] = value >> (8 * b);
+  out.write(buffer, bytes);
+}
+
+void Switches::write_trace_header(Print &out) {
+  const uint8_t header[5] = {'E', 'Z', 'T', trace_version, _num_entries};
+  out.write(header, sizeof(header));
+  put_le(out, _trace != NULL ? _trace->start_time : 0, 4);
+  for (uint8_t sw = 0; sw < _num_entries; sw++) {
+    if (!switch_active(sw)) {
+      // removed, see remove_switch - a placeholder keeps later switch_ids
+      const uint8_t entry[5] = {trace_no_switch, 0, 0, 0, 0};
+      out.write(entry, sizeof(entry));
+      continue;
+    }
+    const uint8_t entry[3] = {switches[sw].switch_type, switches[sw].switch_mode,
+                              switches[sw].switch_on_value};
+    out.write(entry, sizeof(entry));
+    put_le(out, switches[sw].switch_debounce, 2);
+  }
+} // End of write_trace_header
+
+#if ez_switch_metrics
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Switch metrics, present if ez_switch_metrics is set (see
+// ez_switch_config.h). For each switch, every reading taken by the read
+// functions is looked at for contact changes, 'transitions', those
+// within the switch's debounce period of the previous change being
+// bounce, 'bounce_edges'. A burst of bounce is timed from its first
+// change to its last, the longest being 'max_settle'. Switch events
+// reported are counted in 'events'. Counts stop at 65535.
+// Every scan (read_all_switches, poll, scan_dirty_switches, or a pass
+// of read_switch calls over the switches, ie until a switch_id is read
+// again) is timed, microsecs, giving the shortest and longest scans, a
+// histogram of scan times and the longest gap between scans, so that
+// slow loops may be found.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::count_reading(uint8_t sw, bool sw_on, uint32_t now) {
+  switch_metrics &m = metrics[sw];
+  if (sw_on == m.last_on) return;
+  m.last_on = sw_on;
+  if (m.transitions != 0xFFFF) m.transitions++;
+  if (m.transitions > 1 && ez_elapsed(now, m.last_edge) < switches[sw].switch_debounce) {
+    // bounce, the burst continues
+    if (m.bounce_edges != 0xFFFF) m.bounce_edges++;
+    ez_time_t settle = ez_elapsed(now, m.burst_start);
+    if (settle > m.max_settle) m.max_settle = settle;
+  } else {
+    m.burst_start = now;  // first change of a new burst
+  }
+  m.last_edge = now;
+} // End of count_reading
+
+void Switches::record_scan(uint32_t start_us, uint32_t end_us) {
+  uint32_t duration = end_us - start_us;
+  if (scan_stats.scans > 0 && start_us - _last_scan_us > scan_stats.max_gap_us) {
+    scan_stats.max_gap_us = start_us - _last_scan_us;
+  }
+  _last_scan_us = start_us;
+  scan_stats.scans++;
+  if (duration < scan_stats.min_scan_us) scan_stats.min_scan_us = duration;
+  if (duration > scan_stats.max_scan_us) scan_stats.max_scan_us = duration;
+  uint8_t bin = 0;
+  while (duration >= 2 && bin < ez_scan_bins - 1) {
+    duration >>= 1;
+    bin++;
+  }
+  if (scan_stats.histogram[bin] != 0xFFFF) scan_stats.histogram[bin]++;
+} // End of record_scan
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Clear all switch and scan metrics.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::reset_metrics() {
+  for (uint8_t sw = 0; sw < _max_switches; sw++) {
+    metrics[sw].transitions  = 0;
+    metrics[sw].events       = 0;
+    metrics[sw].bounce_edges = 0;
+    metrics[sw].max_settle   = 0;
+    metrics[sw].burst_start  = 0;
+    metrics[sw].last_edge    = 0;
+    metrics[sw].last_on      = false;
+  }
+  scan_stats.scans       = 0;
+  scan_stats.min_scan_us = 0xFFFFFFFF;
+  scan_stats.max_scan_us = 0;
+  scan_stats.max_gap_us  = 0;
+  for (uint8_t bin = 0; bin < ez_scan_bins; bin++) scan_stats.histogram[bin] = 0;
+  _last_read_id = none_switched;
+} // End of reset_metrics
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Print the switch and scan metrics.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::print_metrics() {
+  Serial.println(F("\nScan metrics:"));
+  Serial.print(F("scans = "));
+  Serial.print(scan_stats.scans);
+  if (scan_stats.scans > 0) {
+    Serial.print(F("\tmin = "));
+    Serial.print(scan_stats.min_scan_us);
+    Serial.print(F(" usecs\tmax = "));
+    Serial.print(scan_stats.max_scan_us);
+    Serial.print(F(" usecs\tmax gap = "));
+    Serial.print(scan_stats.max_gap_us);
+    Serial.print(F(" usecs"));
+  }
+  Serial.println();
+  for (uint8_t bin = 0; bin < ez_scan_bins; bin++) {
+    if (scan_stats.histogram[bin] == 0) continue;
+    Serial.print(F("  "));
+    Serial.print(bin == 0 ? 0 : (uint32_t)1 << bin);
+    if (bin < ez_scan_bins - 1) {
+      Serial.print(F("-"));
+      Serial.print(((uint32_t)2 << bin) - 1);
+    } else {
+      Serial.print(F("+"));
+    }
+    Serial.print(F(" usecs\t"));
+    Serial.println(scan_stats.histogram[bin]);
+  }
+  Serial.println(F("Switch metrics:"));
+  Serial.println(F("sw_id\ttransitions\tevents\tbounce edges\tmax settle msecs"));
+  for (uint8_t sw = 0; sw < _num_entries; sw++) {
+    if (!switch_active(sw)) continue;  // removed, see remove_switch
+    Serial.print(sw);
+    Serial.print(F("\t"));
+    Serial.print(metrics[sw].transitions);
+    Serial.print(F("\t\t"));
+    Serial.print(metrics[sw].events);
+    Serial.print(F("\t"));
+    Serial.print(metrics[sw].bounce_edges);
+    Serial.print(F("\t\t"));
+    Serial.println(metrics[sw].max_settle);
+  }
+  Serial.flush();
+} // End of print_metrics
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Write the switch and scan metrics to the given stream (eg Serial) in a
+// compact binary form, all values little endian:
+//   4 bytes  'E', 'Z', 'M', format version 1
+//   1 byte   number of switches, n
+//   1 byte   number of histogram bins, b
+//   uint32   scans, min_scan_us, max_scan_us, max_gap_us
+//   uint16   histogram[b]
+//   n times, one per switch_id:
+//     uint16 transitions, events, bounce_edges, max_settle
+//     (all 0 for switch_ids of removed switches, see remove_switch)
+// ie 22 + 2b + 8n bytes.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::dump_metrics(Print &out) {
+  const uint8_t header[6] = {'E', 'Z', 'M', 1, _num_entries, ez_scan_bins};
+  out.write(header, sizeof(header));
+  put_le(out, scan_stats.scans, 4);
+  put_le(out, scan_stats.min_scan_us, 4);
+  put_le(out, scan_stats.max_scan_us, 4);
+  put_le(out, scan_stats.max_gap_us, 4);
+  for (uint8_t bin = 0; bin < ez_scan_bins; bin++) put_le(out, scan_stats.histogram[bin], 2);
+  for (uint8_t sw = 0; sw < _num_entries; sw++) {
+    bool active = switch_active(sw);
+    put_le(out, active ? metrics[sw].transitions : 0, 2);
+    put_le(out, active ? metrics[sw].events : 0, 2);
+    put_le(out, active ? metrics[sw].bounce_edges : 0, 2);
+    put_le(out, active ? metrics[sw].max_settle : 0, 2);
+  }
+} // End of dump_metrics
+#endif
+
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 // Print given switch control data.
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 void Switches::print_switch(uint8_t sw) {
-  if (0 <= sw && sw < _num_entries ) {
+  if (switch_active(sw)) {
     Serial.print(F("sw_id:   = "));
     Serial.println(sw);
     Serial.print(F("sw_type  = "));
@@ -325,6 +1975,19 @@ void Switches::print_switch(uint8_t sw) {
     else Serial.print(F("TOGGLE SWITCH"));
     Serial.print(F("  sw_pin  = "));
     Serial.print(switches[sw].switch_pin);
+    if (matrix_key(sw)) {
+      uint8_t key = sw - _matrix->first_id;
+      Serial.print(F(" (matrix row "));
+      Serial.print(key / _matrix->num_cols);
+      Serial.print(F(", col "));
+      Serial.print(key % _matrix->num_cols);
+      Serial.print(F(")"));
+    }
+    if (bank_switch(sw)) {
+      Serial.print(F(" (bank "));
+      Serial.print(_port_group[sw] - ez_bank_group(0));
+      Serial.print(F(" input)"));
+    }
     Serial.print(F("\tcirc_type = "));
     uint8_t circ_type = switches[sw].switch_circuit_type;
     if (circ_type == circuit_C1) {
@@ -350,6 +2013,27 @@ void Switches::print_switch(uint8_t sw) {
     Serial.print(F("\tdb_start = "));
     Serial.print(switches[sw].switch_db_start);
     Serial.println(F(" msecs"));
+    Serial.print(F("debounce = "));
+    Serial.print(switches[sw].switch_debounce);
+    Serial.print(F(" msecs"));
+    if (sw_type == button_switch) {
+      Serial.print(F("\tmode = "));
+      if (switches[sw].switch_mode == button_press_mode) Serial.print(F("PRESS"));
+      else if (switches[sw].switch_mode == button_press_release_mode) Serial.print(F("PRESS/RELEASE"));
+      else Serial.print(F("CYCLE"));
+    }
+    if (bounce != NULL && bounce[sw].max_debounce != 0) {
+      Serial.print(F("\tADAPTIVE "));
+      Serial.print(bounce[sw].min_debounce);
+      Serial.print(F("-"));
+      Serial.print(bounce[sw].max_debounce);
+      Serial.print(F(" msecs\tsettle = "));
+      Serial.print(bounce[sw].last_settle);
+      Serial.print(F(" msecs, "));
+      Serial.print(bounce[sw].last_edges);
+      Serial.print(F(" edges"));
+    }
+    Serial.println();
     if (switches[sw].switch_out_pin == 0) {
       // switch does not have a linked output
       Serial.println(F("*** No linked output pin"));
@@ -361,6 +2045,24 @@ void Switches::print_switch(uint8_t sw) {
       if (switches[sw].switch_out_pin_status == LOW)Serial.println(F("LOW"));
       else Serial.println(F("HIGH"));
     }
+    for (uint8_t l = 0; l < _num_links; l++) {
+      if (_links[l].switch_id != sw) continue;
+      Serial.print(F("Output link "));
+      Serial.print(l);
+      Serial.print(F(" pin = "));
+      Serial.print(_links[l].pin);
+      if (_links[l].action == link_toggle) Serial.print(F("\tTOGGLE"));
+      else if (_links[l].action == link_follow) Serial.print(F("\tFOLLOW"));
+      else {
+        Serial.print(F("\tPULSE "));
+        Serial.print(_links[l].pulse_period);
+        Serial.print(F(" msecs"));
+      }
+      Serial.print(F("\ton_level = "));
+      Serial.print(_links[l].active_low ? F("LOW") : F("HIGH"));
+      Serial.print(F("\tstatus = "));
+      Serial.println(_links[l].state ? F("ON") : F("OFF"));
+    }
     Serial.println();
     Serial.flush();
   }
@@ -373,6 +2075,16 @@ void Switches::print_switch(uint8_t sw) {
 void Switches::print_switches() {
   Serial.println(F("\nDeclared & configured switches:"));
   for (uint8_t sw = 0; sw < _num_entries; sw++) {
-    print_switch(sw);
+    if (switch_active(sw)) print_switch(sw);  // removed switches passed over
   }
 } // End print_switches
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Establish the pin/clock backend to be used by this
+// instance. Must be called before any switches are added
+// or outputs linked. A NULL backend restores the default.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switches::set_io(const ez_io_backend *io) {
+  _io = (io == NULL) ? &ez_arduino_io : io;
+} // End set_io
@@ -9,6 +9,43 @@
 //   Sept 2022, version 3.01
 //     change of library variables to unsigned declarations, generally,
 //     eg byte to uint8_t, long unsigned int to uint32_t, etc
+//   Oct 2026, version 3.10
+//     all pin and clock access now made via a pluggable 'ez_io_backend'
+//     (see ez_switch_io.h), function 'set_io' added, allowing native
+//     (host) builds with a simulated GPIO/virtual clock
+//     addition of function 'read_all_switches' (overloaded), a batched
+//     scan of all switches reading each GPIO port register just once
+//     addition of function 'set_debounce_engine', offering a bit-sliced
+//     vertical counter debounce of all switches to read_all_switches
+//     addition of templates 'Static_switches<N>' (no heap) and
+//     'Fixed_switch<type, pin, circuit>' (compile time configured switch)
+//     addition of 'switch_events', a lock-free queue of switch events
+//     filled by the read functions, see ez_switch_events.h
+//     addition of interrupt driven scanning, functions 'mark_switch_dirty',
+//     'mark_pin_dirty', 'mark_all_dirty', 'scan_dirty_switches' and
+//     'switches_idle'
+//     addition of a debounce deadline scheduler for scan_dirty_switches
+//     and function 'next_deadline'
+//     addition of per switch debounce periods, 'set_debounce(switch_id,
+//     period)', and adaptive debounce, 'set_adaptive_debounce'
+//     addition of leading edge button switch modes, 'set_button_mode'
+//     switch control structure packed and no longer volatile, optional
+//     16 bit switch times (see ez_switch_config.h), and 'snapshot'
+//     addition of matrix keypad scanning, 'add_matrix'
+//     addition of input banks, switches on shift registers and GPIO
+//     expanders, 'add_bank', 'add_bank_switch' and 'refresh_banks'
+//     addition of switch handler dispatch, 'set_switch_handler',
+//     'set_event_handler' and 'poll'
+//     addition of multiple output links per switch, 'set_output_links'
+//     and 'add_output_link', with batched port writes
+//     addition of optional switch and scan metrics, 'print_metrics',
+//     'dump_metrics' and 'reset_metrics' (see ez_switch_config.h)
+//     addition of switch pin trace recording, 'set_trace' and
+//     'write_trace_header', see ez_switch_trace.h
+//     addition of 'Switch_scanner', scanning in its own task at a fixed
+//     period, see ez_switch_scanner.h
+//     addition of 'states' and 'pending', all switch states as bitmasks,
+//     and 'remove_switch', removed switches' slots being reused
 //         
 // This example and code is in the public domain and
 // may be used without restriction and without warranty.
@@ -17,6 +54,12 @@
 #ifndef ez_switches_h
 #define ez_switches_h
 #include <Arduino.h>
+#include "ez_switch_config.h"
+#include "ez_switch_io.h"
+#include "ez_vertical_debounce.h"
+#include "ez_switch_events.h"
+#include "ez_input_bank.h"
+#include "ez_switch_trace.h"
 
 class Switches
 {
@@ -43,43 +86,345 @@ class Switches
 #define link_failure         -1      // output pin could not be linked to a switch
 #define none_switched       255      // 'last_switched_id' initialised to this value
 
+#define ez_switch_words(n) (((n) + 31) / 32) // uint32_t words needed for a bitmask of n switches
+#define ez_max_port_groups   12      // max GPIO ports read by read_all_switches, others read by pin
+#define standard_debounce     0      // debounce engine, each switch debounced individually
+#define vertical_debounce     1      // debounce engine, all switches debounced together, bit-sliced
+#define no_deadline  0xFFFFFFFF      // 'next_deadline' return, no switch pending
+#define adaptive_success      0      // adaptive debounce established for a switch
+#define adaptive_failure     -1      // adaptive debounce could not be established
+#define button_cycle_mode     0      // button switch reported once pressed AND released (default)
+#define button_press_mode     1      // button switch reported as soon as pressed, then locked out
+#define button_press_release_mode 2  // button switch reported as soon as pressed and as soon as released
+#define mode_success          0      // button mode set
+#define mode_failure         -1      // button mode could not be set, eg not a button switch
+#define ez_max_matrix_lines  16      // max rows, and max columns, of a matrix keypad
+#define ez_bank_group(bank) (0xF0 + (bank)) // port group of a switch on the given input bank
+#define handler_success       0      // switch/event handler set
+#define handler_failure      -1      // handler could not be set, eg no such switch, no memory
+#define link_toggle           0      // output link action, output flipped each time switched
+#define link_follow           1      // output link action, output follows the switch's state
+#define link_pulse            2      // output link action, output pulsed on each time switched
+#define ez_max_out_ports      8      // max GPIO ports written by output links, others written by pin
+#define ez_scan_bins         12      // scan duration histogram bins, see print_metrics
+#define remove_success        0      // switch removed
+#define remove_failure       -1      // switch could not be removed, eg no such switch, a matrix key
+
     // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
     // %                   Switch Control Sruct(ure) Declaration                 %
     // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+    // Packed, widest fields first and flags as bitfields, so that an entry
+    // is 10 bytes on AVR boards, 12 on 32 bit boards (8 either way with
+    // 16 bit switch times, see ez_switch_config.h).
+    // Entries are not volatile, so may be held in registers by the read
+    // functions. If switches are read in an ISR, use 'snapshot' to take a
+    // consistent copy of an entry outside of the ISR.
     //
     struct switch_control {
-      uint8_t switch_type;         // type of switch connected
+      ez_time_t switch_db_start;   // records debounce start time when associated switch starts transition
+      uint16_t switch_debounce;    // debounce period of this switch, millisecs
       uint8_t switch_pin;          // digital input pin assigned to the switch
       uint8_t switch_circuit_type; // the type of circuit wired to the switch
-      bool switch_on_value;        // used for BUTTON SWITCHES only - defines what "on" means
-      bool switch_pending;         // records if switch in transition or not
-      uint32_t switch_db_start;    // records debounce start time when associated switch starts transition
-      bool switch_status;          // used for TOGGLE SWITCHES only - current state of toggle switch.
       uint8_t switch_out_pin;      // the digital pin mapped to this switch, if any
-      bool switch_out_pin_status;  // the status of the mapped pin
-    } volatile *switches;          // memory will be created when class is instantiated
+      uint8_t switch_type : 2;     // type of switch connected
+      uint8_t switch_mode : 2;     // used for BUTTON SWITCHES only - when the switch is reported
+      bool switch_on_value : 1;    // used for BUTTON SWITCHES only - defines what "on" means
+      bool switch_pending : 1;     // records if switch in transition or not
+      bool switch_status : 1;      // used for TOGGLE SWITCHES only - current state of toggle switch.
+      bool switch_out_pin_status : 1; // the status of the mapped pin
+    } *switches;                   // memory will be created when class is instantiated
 
     volatile uint8_t last_switched_id = none_switched;
 
+    // Output links, a switch driving any number of outputs, see
+    // set_output_links and add_output_link
+    struct output_link {
+      ez_time_t pulse_start;       // start of the current pulse, link_pulse
+      uint16_t pulse_period;       // millisecs, link_pulse
+      uint8_t  switch_id;          // the switch driving the output
+      uint8_t  pin;                // the output pin
+      uint8_t  out_group;          // index into _out_ports, or ez_no_port if written by pin
+      uint8_t  out_bit;            // bit number of the pin in its port
+      uint8_t  action : 2;         // link_toggle, link_follow or link_pulse
+      bool     active_low : 1;     // output LOW when 'on'
+      bool     state : 1;          // output 'on' or not
+      bool     pulsing : 1;        // pulse in progress
+    };
+
+    // Bounce measurements of switches under adaptive debounce, see
+    // set_adaptive_debounce. Memory is only created on first use.
+    struct bounce_stats {
+      uint16_t min_debounce;       // bounds of the switch's debounce period,
+      uint16_t max_debounce;       // max_debounce 0 if not adaptive
+      uint16_t settle_peak;        // decaying peak of observed settle times, millisecs
+      uint16_t last_settle;        // settle time of the last burst of edges, millisecs
+      uint8_t  last_edges;         // edges seen in the last burst
+      uint8_t  max_edges;          // most edges seen in any burst
+      uint8_t  edges;              // edges seen so far in the current burst
+      bool     last_on;            // last reading, for edge detection
+      ez_time_t burst_start;       // time of the first edge of the current burst
+      ez_time_t last_edge;         // time of the latest edge of the current burst
+    } *bounce = NULL;
+
+#if ez_switch_metrics
+    // Switch metrics, one per switch, and scan metrics, see print_metrics.
+    // Only present if ez_switch_metrics is set, see ez_switch_config.h
+    struct switch_metrics {
+      uint16_t transitions;        // contact changes seen
+      uint16_t events;             // switch events reported
+      uint16_t bounce_edges;       // contact changes within the debounce period of the previous one
+      uint16_t max_settle;         // longest burst of such changes, first to last, millisecs
+      ez_time_t burst_start;       // time of the first change of the current burst
+      ez_time_t last_edge;         // time of the latest change
+      bool     last_on;            // last reading, for change detection
+    } *metrics;
+    struct scan_metrics {
+      uint32_t scans;              // scans timed
+      uint32_t min_scan_us;        // shortest scan, microsecs
+      uint32_t max_scan_us;        // longest scan, microsecs
+      uint32_t max_gap_us;         // longest time between the starts of successive scans, microsecs
+      uint16_t histogram[ez_scan_bins]; // scans by duration, bin n for 2^n to 2^(n+1)-1 microsecs
+    } scan_stats;
+#endif
+
+    // Queue of switch events, filled by the read functions once
+    // established by the end user, eg
+    //   switch_event my_events[16];
+    //   my_switches.switch_events.begin(my_events, 16);
+    Switch_event_queue switch_events;
+
     // Functions available to end users
     bool read_switch           (uint8_t switch_id);
     bool read_toggle_switch    (uint8_t switch_id);
     bool read_button_switch    (uint8_t switch_id);
     int  add_switch            (uint8_t sw_type, uint8_t sw_pin, uint8_t circ_type);
+    int  add_matrix            (const uint8_t row_pins[], uint8_t num_rows,
+                                const uint8_t col_pins[], uint8_t num_cols,
+                                uint8_t sw_type, bool diodes);
+    int  add_bank              (Input_bank &bank);
+    int  add_bank_switch       (uint8_t sw_type, uint8_t bank_id, uint8_t input, uint8_t circ_type);
+    int  remove_switch         (uint8_t switch_id);
+    void refresh_banks         ();
+    int  set_switch_handler    (uint8_t switch_id, switch_handler handler,
+                                void *context = NULL, uint8_t kinds = all_events);
+    int  set_event_handler     (uint8_t event_kind, switch_handler handler, void *context = NULL);
+    uint8_t poll               ();
     int  link_switch_to_output (uint8_t switch_id, uint8_t output_pin, bool HorL);
+    int  set_output_links      (output_link links[], uint8_t capacity);
+    int  add_output_link       (uint8_t switch_id, uint8_t output_pin, uint8_t action,
+                                bool on_level = HIGH, uint16_t pulse_period = 0);
     int  num_free_switch_slots ();
     void set_debounce          (uint16_t period);
+    void set_debounce          (uint8_t switch_id, uint16_t period);
+    int  set_adaptive_debounce (uint8_t switch_id, uint16_t min_period, uint16_t max_period);
+    int  set_button_mode       (uint8_t switch_id, uint8_t mode);
     void reset_switch          (uint8_t switch_id);
     void reset_switches        ();
     bool button_is_pressed     (uint8_t switch_id, bool process_link);
     bool button_is_pressed     (uint8_t switch_id);
     void print_switch          (uint8_t switch_id);
     void print_switches        ();
+    void set_io                (const ez_io_backend *io);
+    uint8_t  read_all_switches (uint32_t switched_mask[]);
+    uint32_t read_all_switches ();
+    void states                (uint32_t state_mask[]);
+    uint32_t states            ();
+    void pending               (uint32_t pending_mask[]);
+    uint32_t pending           ();
+    void set_debounce_engine   (uint8_t engine);
+    void mark_switch_dirty     (uint8_t switch_id);
+    void mark_pin_dirty        (uint8_t pin);
+    void mark_all_dirty        ();
+    uint8_t scan_dirty_switches(uint32_t switched_mask[] = NULL);
+    bool switches_idle         ();
+    uint32_t next_deadline     ();
+    bool snapshot              (uint8_t switch_id, switch_control &copy);
+    void set_trace             (Switch_trace *trace);
+    void write_trace_header    (Print &out);
+#if ez_switch_metrics
+    void print_metrics         ();
+    void dump_metrics          (Print &out);
+    void reset_metrics         ();
+#endif
+
+    // Bytes of memory needed for the given number of switches,
+    // see assign_storage
+    static constexpr size_t storage_size(uint8_t max_switches) {
+      return sizeof(switch_control) * max_switches +
+             sizeof(Vertical_debouncer<uint32_t>) * ez_switch_words(max_switches) +
+             sizeof(uint32_t) * ez_switch_words(max_switches) * 4 +
+             4 * max_switches
+#if ez_switch_metrics
+             + sizeof(switch_metrics) * max_switches
+#endif
+             ;
+    }
+
+  protected:
+    Switches(uint8_t max_switches, void *storage);
+    friend class Switch_scanner;  // scans and publishes the switch states
 
   private:
+    void    assign_storage     (uint8_t max_switches, void *storage);
+    bool    debounce_toggle    (uint8_t sw, bool sw_on, uint32_t now);
+    bool    debounce_button    (uint8_t sw, bool sw_on, uint32_t now);
+    bool    debounce_leading   (uint8_t sw, bool sw_on, uint32_t now);
+    void    flip_linked_output (uint8_t sw);
+    void    report_switched    (uint8_t sw, uint8_t event_kind, uint32_t now);
+    bool    process_switch     (uint8_t sw, bool sw_on, uint32_t now);
+    ez_time_t deadline_of      (uint8_t sw);
+    void    insert_deadline    (uint8_t sw);
+    void    remove_deadline    (uint8_t sw);
+    void    sift_deadline      (uint8_t pos);
+    void    reschedule         (uint8_t sw);
+    void    measure_bounce     (uint8_t sw, bool sw_on, uint32_t now);
+    void    end_burst          (uint8_t sw);
+    void    adapt_debounce     (uint8_t sw);
+    uint8_t scan_switches      (uint32_t switched_mask[], uint8_t mask_words);
+    bool    sample_switch      (uint8_t sw, const ez_port_mask_t port_value[]);
+    bool    read_contact       (uint8_t sw);
+    bool    matrix_key         (uint8_t sw) {
+      return _matrix != NULL && (uint8_t)(sw - _matrix->first_id) < _matrix->num_keys;
+    }
+    bool    read_key           (uint8_t sw);
+    void    scan_matrix        ();
+    void    suppress_ghosts    ();
+    uint8_t scan_vertical      (const ez_port_mask_t port_value[], uint32_t now,
+                                uint32_t switched_mask[], uint8_t mask_words);
+    void    assign_port_group  (uint8_t sw);
+    void    init_switch        (uint8_t sw, uint8_t sw_type, uint8_t sw_pin, uint8_t circ_type);
+    int     take_slot          ();
+    void    place_switch       (uint8_t sw, uint8_t sw_type, uint8_t sw_pin, uint8_t circ_type);
+    bool    switch_active      (uint8_t sw) {
+      return sw < _num_entries && ((_active_bits[sw / 32] >> (sw % 32)) & 1);
+    }
+    void    set_pending        (uint8_t sw, bool pending) {
+      switches[sw].switch_pending = pending;
+      if (pending) _pending_bits[sw / 32] |= (uint32_t)1 << (sw % 32);
+      else _pending_bits[sw / 32] &= ~((uint32_t)1 << (sw % 32));
+    }
+    void    set_status         (uint8_t sw, bool status) {  // toggle switches only
+      switches[sw].switch_status = status;
+      if (status == on) _state_bits[sw / 32] |= (uint32_t)1 << (sw % 32);
+      else _state_bits[sw / 32] &= ~((uint32_t)1 << (sw % 32));
+    }
+    bool    bank_switch        (uint8_t sw) {
+      return _port_group[sw] != ez_no_port && _port_group[sw] >= ez_bank_group(0);
+    }
+    bool    read_bank_input    (uint8_t sw);
+    bool    assign_handlers    ();
+    void    dispatch           (uint8_t sw, uint8_t event_kind);
+    void    drive_links        (uint8_t sw, uint8_t event_kind);
+    void    set_link           (output_link &link, bool link_on);
+    void    end_pulses         (uint32_t now);
+    void    commit_outputs     ();
+    void    trace_reading      (uint8_t sw, bool sw_on) {
+      if (_trace != NULL && _trace->is_change(sw, sw_on)) _trace->record(sw, sw_on, clock_us());
+    }
+    uint32_t clock_us          () {
+      return _io->read_clock_us != NULL ? _io->read_clock_us() : _io->read_clock() * 1000;
+    }
+#if ez_switch_metrics
+    void    count_reading      (uint8_t sw, bool sw_on, uint32_t now);
+    void    record_scan        (uint32_t start_us, uint32_t end_us);
+#endif
+
     uint8_t  _num_entries  = 0;  // used for adding switches to switch control structure/list
     uint8_t  _max_switches = 0;  // max switches user has initialise
-    uint16_t _debounce    = 10; // 10 millisecs if not specified by user code
+
+    // switches in use, and their states, one bit per switch, see states.
+    // Removed switches' slots are chained through their switch_pin, from
+    // _free_head, for reuse, see remove_switch
+    uint32_t *_active_bits;        // switch slots in use
+    uint32_t *_state_bits;         // toggle switches on
+    uint32_t *_pending_bits;       // switches pending
+    uint8_t  _free_head = none_switched;  // latest removed slot, or none_switched
+    uint8_t  _num_free  = 0;       // removed slots awaiting reuse
+    uint16_t _debounce    = 10; // 10 millisecs if not specified by user code, given to each switch added
+    const ez_io_backend *_io = &ez_arduino_io; // pin and clock access, Arduino core unless set_io used
+
+    // port groupings of switch pins, for batched reading by read_all_switches
+    struct port_group {
+      uint8_t        port;         // port number, as given by the backend
+      ez_port_mask_t invert;       // bits of circuit_C2 (active LOW) switch pins
+    } _port_groups[ez_max_port_groups];
+    uint8_t  _num_port_groups = 0;
+    uint8_t *_port_group;          // per switch, index into _port_groups, ez_bank_group or ez_no_port
+    uint8_t *_port_bit;            // per switch, bit number of the switch pin in its port
+
+    // bit-sliced debounce engine, see set_debounce_engine
+    uint8_t  _engine         = standard_debounce;
+    Vertical_debouncer<uint32_t> *_vc;  // one set of vertical counters per 32 switches
+    uint16_t _vc_interval    = 4;  // millisecs between samples, a third of _debounce
+    uint32_t _vc_sample_time = 0;  // time of last sample
+
+    // interrupt driven scanning, see scan_dirty_switches
+    volatile uint32_t *_dirty_bits;  // switches marked dirty by ISRs, one bit per switch
+    uint8_t *_deadlines;             // min-heap of pending switch ids, by debounce deadline
+    uint8_t *_deadline_pos;          // per switch, position in _deadlines or no_deadline_pos
+    uint8_t  _num_deadlines = 0;     // entries in _deadlines
+#define no_deadline_pos     255
+
+    // matrix keypad, see add_matrix
+    struct key_matrix {
+      const uint8_t *row_pins;     // the user's row and column pin arrays
+      const uint8_t *col_pins;
+      uint8_t  num_rows;
+      uint8_t  num_cols;
+      uint8_t  first_id;           // switch_id of the key at row 0, column 0
+      uint8_t  num_keys;
+      bool     diodes;             // keys have diodes, so no ghosting
+      uint16_t row_groups;         // port groups holding row pins, one bit per group
+      uint8_t  row_group[ez_max_matrix_lines];  // per row, port group or ez_no_port
+      uint8_t  row_bit[ez_max_matrix_lines];    // per row, bit number of the row pin in its port
+      uint16_t sample[ez_max_matrix_lines];     // per row, bit per column set if key 'on'
+    } *_matrix = NULL;
+
+    // input banks, see add_bank. A bank switch's port group is given as
+    // ez_bank_group(bank_id), its switch_pin being its input on the bank
+    Input_bank *_banks[ez_max_banks];
+    uint8_t  _num_banks = 0;
+
+    // handler dispatch, see poll. Memory is only created on first use
+    struct handler_entry {
+      switch_handler handler;      // the switch's own handler, or NULL
+      void    *context;
+      uint8_t  kinds;              // event kinds handled, ez_event_mask bits
+      uint8_t  fired;              // kind of the switch's latest event
+    } *_handlers = NULL;
+    struct {
+      switch_handler handler;      // per event kind, for switches without their own handler
+      void    *context;
+    } _event_handlers[button_release_event] = {};
+
+    // output links, see add_output_link. Output changes are gathered
+    // into per port set/clear masks and written once per scan
+    output_link *_links = NULL;    // user supplied link storage
+    uint8_t  _link_capacity = 0;
+    uint8_t  _num_links     = 0;
+    uint8_t  _num_pulsing   = 0;   // links with a pulse in progress
+    uint8_t  _last_event_kind = 0; // kind of the latest event, see report_switched
+    bool     _outputs_pending = false;
+    struct out_port {
+      uint8_t        port;         // port number, as given by the backend
+      ez_port_mask_t set;          // output bits to set at the next commit
+      ez_port_mask_t clear;        // output bits to clear at the next commit
+    } _out_ports[ez_max_out_ports];
+    uint8_t  _num_out_ports = 0;
+
+    // pin trace recorder, see set_trace
+    Switch_trace *_trace = NULL;
+
+#if ez_switch_metrics
+    // scan timing, see record_scan
+    uint32_t _last_scan_us;        // start of the latest scan
+    uint32_t _pass_start_us;       // start and end of the current pass of read_switch calls
+    uint32_t _pass_end_us;
+    uint8_t  _last_read_id;        // switch_id of the latest read_switch call, or none_switched
+#endif
 };
 
+#include "ez_switch_static.h"
+#include "ez_switch_scanner.h"
+
 #endif
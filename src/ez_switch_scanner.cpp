@@ -0,0 +1,156 @@
+// Arduino Switch Library - concurrent switch scanner.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <Arduino.h>
+#include "ez_switch_scanner.h"
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Start scanning every 'period' millisecs, the first scan at once.
+// On boards without a scanner task, the scans are then made by the
+// sketch calling scan_once.
+// Returns scanner_success or scanner_failure.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switch_scanner::start(uint16_t period) {
+  if (_running || period == 0) return scanner_failure;
+  _period    = period;
+  _next_scan = _switches._io->read_clock();
+  _running   = true;
+#if defined(ARDUINO_ARCH_ESP32)
+  TaskHandle_t task;
+  if (xTaskCreatePinnedToCore(scanner_task, "ez_scanner", ez_scanner_stack, this,
+                              ez_scanner_priority, &task, ez_scanner_core) != pdPASS) {
+    _running = false;
+    return scanner_failure;
+  }
+  _task = task;
+#elif defined(ez_switch_native)
+  _thread = std::thread([this]() {
+    // the virtual clock is moved on by the test, so looked at often
+    while (_running) {
+      if (!scan_due()) std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+  });
+#endif
+  return scanner_success;
+} // End start
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Stop scanning, waiting for any scan in progress to end, after which
+// the Switches instance may again be used directly.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switch_scanner::stop() {
+  if (!_running) return;
+  _running = false;
+#if defined(ARDUINO_ARCH_ESP32)
+  while (_task != NULL) delay(1);  // the task ends itself
+#elif defined(ez_switch_native)
+  if (_thread.joinable()) _thread.join();
+#endif
+} // End stop
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Boards without a scanner task - scan if a scan is due, returning true
+// if so. To be called from loop() (or loop1()) as often as possible.
+// Always false on boards with a scanner task, whose task alone scans.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switch_scanner::scan_once() {
+#if ez_scanner_task
+  return false;
+#else
+  return scan_due();
+#endif
+} // End scan_once
+
+bool Switch_scanner::scan_due() {
+  if (!_running) return false;
+  uint32_t now = _switches._io->read_clock();
+  if ((int32_t)(now - _next_scan) < 0) return false;  // not yet due
+  if (now - _next_scan >= _period) {
+    // a period or more late, so start the periods afresh
+    if (overruns < 0xFFFF) overruns++;
+    _next_scan = now;
+  }
+  _next_scan += _period;
+  scan();
+  return true;
+} // End scan_due
+
+#if defined(ARDUINO_ARCH_ESP32)
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// ESP32 scanner task, scanning every period until stopped.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switch_scanner::scanner_task(void *scanner) {
+  Switch_scanner *self = (Switch_scanner *)scanner;
+  TickType_t period = pdMS_TO_TICKS(self->_period);
+  if (period == 0) period = 1;
+  TickType_t wake = xTaskGetTickCount();
+  while (self->_running) {
+    self->scan();
+    if ((TickType_t)(xTaskGetTickCount() - wake) >= period) {
+      // a period or more late, so start the periods afresh
+      if (self->overruns < 0xFFFF) self->overruns++;
+      wake = xTaskGetTickCount();
+    }
+    vTaskDelayUntil(&wake, period);
+  }
+  self->_task = NULL;
+  vTaskDelete(NULL);
+} // End scanner_task
+#endif
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Scan all switches, queuing any events and driving any linked outputs,
+// then publish the switch states. The sequence count is odd whilst the
+// states are being written, so readers can tell a copy is inconsistent.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switch_scanner::scan() {
+  uint32_t switched_mask[ez_scanner_words];
+  _switches.read_all_switches(switched_mask);
+  uint32_t sequence = _sequence;
+  _sequence = sequence + 1;  // publishing
+  ez_memory_barrier();
+  _switches.states(_on_bits);
+  _switches.pending(_pending_bits);
+  ez_memory_barrier();
+  _sequence = sequence + 2;  // published
+  scans++;
+} // End scan
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Copy the switch states as at the latest scan, one bit per switch_id
+// (bit n of word n/32), into the given arrays of 'words' words, either
+// of which may be NULL:
+//   on_bits      - toggle switches on, see Switches::states,
+//   pending_bits - switches pending, so button switches pressed, see
+//                  Switches::pending.
+// The copy is always consistent, ie from one scan, being retried should
+// a scan publish part way through. Never waits on the scanner, but on
+// single core boards must not be called from an ISR, which could
+// interrupt a publish and so retry forever.
+// Returns the number of scans published, 0 if none yet.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint32_t Switch_scanner::read_states(uint32_t on_bits[], uint32_t pending_bits[], uint8_t words) {
+  if (words > ez_scanner_words) words = ez_scanner_words;
+  uint32_t sequence;
+  do {
+    sequence = _sequence;
+    ez_memory_barrier();  // states read after the sequence count
+    for (uint8_t word = 0; word < words; word++) {
+      if (on_bits != NULL) on_bits[word] = _on_bits[word];
+      if (pending_bits != NULL) pending_bits[word] = _pending_bits[word];
+    }
+    ez_memory_barrier();  // states read before the sequence count is checked
+  } while ((sequence & 1) != 0 || sequence != _sequence);
+  return sequence / 2;
+} // End read_states
@@ -0,0 +1,114 @@
+// Arduino Switch Library - concurrent switch scanner.
+//
+// Runs the scanning of a Switches instance at a fixed period in its
+// own task, so that the switches are scanned on time whatever the
+// application is doing, eg on dual core boards with the scanning on
+// one core and the application on the other:
+//   ESP32        - a FreeRTOS task, pinned to core ez_scanner_core,
+//   native build - a std::thread, timed by the virtual clock, so
+//                  the scanner may be tested on the host,
+//   other boards - no task, the sketch calls 'scan_once' from loop()
+//                  (or, on the RP2040, from loop1() so scanning on the
+//                  second core), which scans once each period.
+//
+// Once started, the Switches instance belongs to the scanner - the
+// application must not call its read functions, nor change it, until
+// the scanner is stopped. Linked outputs are driven, and
+// 'last_switched_id' updated, by the scanner alone. The application
+// instead takes:
+//   switch events - from the instance's 'switch_events' queue, which
+//                   must be established (see ez_switch_events.h), a
+//                   lock-free single producer/single consumer queue,
+//   switch states - from 'read_states', a consistent copy of every
+//                   switch's state and pending flag as bitmasks, as at
+//                   the latest scan.
+// Neither ever blocks the scanner - the states are published under a
+// sequence count that readers check, retrying should a scan publish
+// whilst they copy (a seqlock).
+//   Switch_scanner my_scanner(my_switches);
+//   my_scanner.start(1);  // scan every millisec
+//   ...
+//   uint32_t on_bits[ez_switch_words(num_switches)];
+//   my_scanner.read_states(on_bits, NULL, ez_switch_words(num_switches));
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_switch_scanner_h
+#define ez_switch_scanner_h
+#include <Arduino.h>
+#include "ez_switch_lib.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define ez_scanner_task       1      // scans in a FreeRTOS task
+#elif defined(ez_switch_native)
+#include <thread>
+#include <chrono>
+#define ez_scanner_task       1      // scans in a std::thread
+#else
+#define ez_scanner_task       0      // scans by scan_once, called by the sketch
+#endif
+
+// Flag and counts shared with the scanner task, atomic where the task
+// runs concurrently, volatile where scan_once runs from loop()/loop1()
+#if ez_scanner_task
+#include <atomic>
+template <typename T> using ez_scanner_shared = std::atomic<T>;
+#else
+template <typename T> using ez_scanner_shared = volatile T;
+#endif
+
+#ifndef ez_scanner_core
+#define ez_scanner_core       0      // ESP32, core of the scanner task, Arduino loop() being on core 1
+#endif
+#ifndef ez_scanner_priority
+#define ez_scanner_priority   5      // ESP32, scanner task priority, loop() being 1
+#endif
+#ifndef ez_scanner_stack
+#define ez_scanner_stack   2048      // ESP32, scanner task stack, bytes
+#endif
+
+#define scanner_success       0      // scanner started
+#define scanner_failure      -1      // scanner already started, zero period, or no task
+#define ez_scanner_words      ez_switch_words(255)  // bitmask words published, ie all switch_ids
+
+class Switch_scanner
+{
+  public:
+    Switch_scanner(Switches &switches) : _switches(switches) {}
+    ~Switch_scanner() { stop(); }
+
+    int      start       (uint16_t period);
+    void     stop        ();
+    bool     scan_once   ();
+    uint32_t read_states (uint32_t on_bits[], uint32_t pending_bits[], uint8_t words);
+    bool     is_running  () { return _running; }
+
+    ez_scanner_shared<uint32_t> scans{0};     // scans made
+    ez_scanner_shared<uint16_t> overruns{0};  // scans started a period or more late
+
+  private:
+    bool     scan_due    ();
+    void     scan        ();
+
+    Switches &_switches;
+    uint16_t  _period    = 1;          // millisecs between scans
+    uint32_t  _next_scan = 0;          // time the next scan is due, millisecs
+    ez_scanner_shared<bool> _running{false};
+    volatile uint32_t _sequence = 0;   // states published, twice over, odd whilst publishing
+    uint32_t  _on_bits[ez_scanner_words] = {};      // per switch, toggle switch on
+    uint32_t  _pending_bits[ez_scanner_words] = {}; // per switch, switch_pending
+#if defined(ARDUINO_ARCH_ESP32)
+    static void scanner_task(void *scanner);
+    std::atomic<TaskHandle_t> _task{NULL};  // NULL once the task has ended
+#elif defined(ez_switch_native)
+    std::thread _thread;
+#endif
+};
+
+#endif
@@ -0,0 +1,171 @@
+// Arduino Switch Library - compile time configured switches.
+//
+// Two templates are offered for sketches whose switch set up is known
+// at compile time:
+//
+//   Static_switches<N>  - a Switches instance for N switches whose
+//                         switch control structure is held in static
+//                         memory rather than acquired from the heap.
+//                         Use exactly as the Switches class, eg
+//                           Static_switches<6> my_switches;
+//                           my_switches.add_switch(button_switch, 2, circuit_C2);
+//
+//   Fixed_switch<type, pin, circuit[, debounce[, mode]]>
+//                       - a single switch whose type, pin, circuit,
+//                         debounce period (millisecs, default 10) and,
+//                         for button switches, mode (default
+//                         button_cycle_mode, see Switches::set_button_mode)
+//                         are template parameters. These are validated at
+//                         compile time and each read reduces to
+//                         straight-line code for that type and circuit,
+//                         eg
+//                           Fixed_switch<toggle_switch, 3, circuit_C1> my_toggle;
+//                           my_toggle.begin();            // in setup()
+//                           if (my_toggle.read_switch() == switched) {...}
+//                         As Switches, pins and clock are accessed via
+//                         ez_arduino_io unless another backend is given
+//                         by 'set_io' before 'begin', see ez_switch_io.h.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_switch_static_h
+#define ez_switch_static_h
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Switches with static storage for N switches. The storage is held in
+// a base class so that it exists before the Switches base is set up.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+template <uint8_t N>
+struct Static_switches_storage {
+  uint32_t _static_storage[(Switches::storage_size(N) + sizeof(uint32_t) - 1) / sizeof(uint32_t)];
+};
+
+template <uint8_t N>
+class Static_switches : private Static_switches_storage<N>, public Switches
+{
+    static_assert(N > 0 && N < none_switched, "Static_switches<N> - N must be 1 to 254");
+  public:
+    Static_switches() : Switches(N, this->_static_storage) {}
+};
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// A single switch configured entirely at compile time. The public data
+// members mirror those of the Switches class's switch control structure.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+template <uint8_t sw_type, uint8_t sw_pin, uint8_t circ_type, uint16_t debounce = 10,
+          uint8_t sw_mode = button_cycle_mode>
+class Fixed_switch
+{
+    static_assert(sw_type == button_switch || sw_type == toggle_switch,
+                  "Fixed_switch - switch type must be button_switch or toggle_switch");
+    static_assert(circ_type == circuit_C1 || circ_type == circuit_C2 || circ_type == circuit_C3,
+                  "Fixed_switch - circuit type must be circuit_C1, circuit_C2 or circuit_C3");
+    static_assert(sw_mode == button_cycle_mode ||
+                  (sw_type == button_switch && (sw_mode == button_press_mode || sw_mode == button_press_release_mode)),
+                  "Fixed_switch - mode must be button_cycle_mode, or for button switches button_press_mode or button_press_release_mode");
+
+  public:
+    // circuit_C2 (INPUT_PULLUP) switches are 'on' when LOW, others when HIGH
+    static constexpr bool switch_on_value = (circ_type == circuit_C2) ? LOW : HIGH;
+
+    bool     switch_pending        = false;  // records if switch in transition or not
+    ez_time_t switch_db_start      = (ez_time_t)(0 - debounce);  // debounce start time of current transition
+    bool     switch_status         = (sw_type == button_switch) ? not_used : !on;
+    uint8_t  switch_out_pin        = 0;      // the digital pin linked to this switch, if any
+    bool     switch_out_pin_status = LOW;    // the status of the linked pin
+
+    // Establish the pin/clock backend, as per Switches::set_io. Must be
+    // called before begin. A NULL backend restores the default.
+    void set_io(const ez_io_backend *io) {
+      _io = (io != NULL) ? io : &ez_arduino_io;
+    }
+
+    // Establish the switch pin, call from setup()
+    void begin() {
+      _io->set_pin_mode(sw_pin, circ_type);
+    }
+
+    // Read the switch, as per Switches::read_switch, processing any
+    // linked output if switched
+    bool read_switch() {
+      bool sw_status = debounce_switch();
+      if (sw_status == switched && switch_out_pin > 0) {
+        switch_out_pin_status = !switch_out_pin_status;
+        _io->write_pin(switch_out_pin, switch_out_pin_status);
+      }
+      return sw_status;
+    }
+
+    // Link (or delink, output_pin 0) an output to the switch,
+    // as per Switches::link_switch_to_output
+    int link_switch_to_output(uint8_t output_pin, bool HorL) {
+      if (output_pin == 0) {
+        if (switch_out_pin == 0) return link_failure;  // no output pin previously defined
+        _io->write_pin(switch_out_pin, HorL);
+      } else {
+        _io->set_pin_mode(output_pin, OUTPUT);
+        _io->write_pin(output_pin, HorL);
+      }
+      switch_out_pin        = output_pin;
+      switch_out_pin_status = HorL;
+      return link_success;
+    }
+
+    // Button switches only, true if CURRENTLY pressed, ie in transition,
+    // as per Switches::button_is_pressed
+    bool button_is_pressed(bool process_link = false) {
+      static_assert(sw_type == button_switch, "Fixed_switch - button_is_pressed applies to button switches only");
+      if (process_link) read_switch();
+      else debounce_switch();  // ignores any linked output
+      return switch_pending;
+    }
+
+  private:
+    const ez_io_backend *_io = &ez_arduino_io;  // pin and clock access, see set_io
+
+    // The debounce cycle, as per Switches::read_button_switch or
+    // Switches::read_toggle_switch, resolved at compile time
+    bool debounce_switch() {
+      bool sw_on   = _io->read_pin(sw_pin) == switch_on_value;
+      uint32_t now = _io->read_clock();
+      if (sw_mode != button_cycle_mode) {
+        // leading edge button, changes taken at once then locked out
+        if (sw_on == switch_pending || ez_elapsed(now, switch_db_start) < debounce) return !switched;
+        switch_pending  = sw_on;
+        switch_db_start = now;
+        return (sw_on || sw_mode == button_press_release_mode) ? switched : !switched;
+      }
+      if (sw_type == button_switch) {
+        if (sw_on) {
+          // pressed, so start/restart debounce process
+          switch_pending  = true;
+          switch_db_start = now;
+        } else if (switch_pending && ez_elapsed(now, switch_db_start) >= debounce) {
+          // released and debounce time elapsed, so press cycle complete
+          switch_pending = false;
+          return switched;
+        }
+      } else {
+        if (sw_on != switch_status && !switch_pending) {
+          // change detected so start debounce cycle
+          switch_pending  = true;
+          switch_db_start = now;
+        }
+        if (switch_pending && ez_elapsed(now, switch_db_start) >= debounce) {
+          // debounce period elapsed so switch has settled after transition
+          switch_status  = !switch_status;
+          switch_pending = false;
+          return switched;
+        }
+      }
+      return !switched;
+    }
+};
+
+#endif
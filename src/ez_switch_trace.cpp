@@ -0,0 +1,144 @@
+// Arduino Switch Library - switch pin trace recorder.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#include <Arduino.h>
+#include "ez_switch_trace.h"
+#include "ez_switch_events.h"
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Establish the recorder in the given buffer of 'capacity' bytes, at
+// least trace_min_buffer. No switches are recorded until chosen by
+// record_switch or record_all.
+// Returns trace_success or trace_failure.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int Switch_trace::begin(uint8_t *buffer, uint16_t capacity) {
+  if (buffer == NULL || capacity < trace_min_buffer) return trace_failure;
+  _capacity = capacity;
+  _buffer   = buffer;
+  for (uint8_t word = 0; word < 8; word++) _recorded[word] = 0;
+  start(0);
+  return trace_success;
+} // End begin
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Choose whether the given switch's transitions are recorded, or all.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switch_trace::record_switch(uint8_t switch_id, bool record) {
+  uint32_t bit = (uint32_t)1 << (switch_id & 31);
+  if (record) _recorded[switch_id >> 5] |= bit;
+  else _recorded[switch_id >> 5] &= ~bit;
+} // End record_switch
+
+void Switch_trace::record_all() {
+  for (uint8_t word = 0; word < 8; word++) _recorded[word] = 0xFFFFFFFF;
+} // End record_all
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Start a new trace at the given time, discarding anything not drained.
+// Called by Switches::set_trace, so not to be used whilst draining.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switch_trace::start(uint32_t time_us) {
+  _head      = 0;
+  _tail      = 0;
+  _lost      = 0;
+  overflows  = 0;
+  start_time = time_us;
+  _last_time = time_us;
+  for (uint8_t word = 0; word < 8; word++) _seen[word] = 0;
+} // End start
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Producer end - record a reading of the given switch, its contact
+// having changed, see is_change. Should the buffer be full the record
+// is lost and counted, a count of the records lost being recorded once
+// there is room.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void Switch_trace::record(uint8_t switch_id, bool sw_on, uint32_t time_us) {
+  uint8_t  word = switch_id >> 5;
+  uint32_t bit  = (uint32_t)1 << (switch_id & 31);
+  _seen[word] |= bit;
+  if (sw_on) _contact[word] |= bit;
+  else _contact[word] &= ~bit;
+  if (_buffer == NULL) return;  // not established
+  if (_lost == 0 || put_record(trace_lost, _lost >> 1, _lost & 1)) {
+    _lost = 0;
+    if (put_record(switch_id, time_us - _last_time, sw_on)) {
+      _last_time = time_us;
+      return;
+    }
+  }
+  if (_lost < 0xFFFF) _lost++;
+  if (overflows < 0xFFFF) overflows++;
+} // End record
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Append a record of the given id and varint, the varint's value being
+// (value << 1) | low_bit, returning false if there is no room.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool Switch_trace::put_record(uint8_t id, uint32_t value, uint8_t low_bit) {
+  uint8_t record[6];  // id and up to 5 varint bytes, 33 bits
+  uint8_t size = 0;
+  record[size++] = id;
+  uint8_t next = low_bit | ((uint8_t)(value << 1) & 0x7F);
+  value >>= 6;
+  while (value != 0) {
+    record[size++] = next | 0x80;
+    next   = value & 0x7F;
+    value >>= 7;
+  }
+  record[size++] = next;
+  uint16_t head = _head;
+  uint16_t used = head >= _tail ? head - _tail : head + _capacity - _tail;
+  if (_capacity - 1 - used < size) return false;  // full
+  for (uint8_t b = 0; b < size; b++) {
+    _buffer[head] = record[b];
+    if (++head == _capacity) head = 0;
+  }
+  ez_memory_barrier();  // record written before it is published
+  _head = head;
+  return true;
+} // End put_record
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Consumer end - write up to 'max_bytes' of the trace to the given
+// stream, returning the number written. To avoid waiting on a slow
+// stream, eg Serial, 'max_bytes' may be given as Serial.availableForWrite().
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint16_t Switch_trace::drain(Print &out, uint16_t max_bytes) {
+  uint16_t head    = _head;
+  uint16_t tail    = _tail;
+  uint16_t drained = 0;
+  ez_memory_barrier();  // records read after they were published
+  while (tail != head && drained < max_bytes) {
+    uint16_t size = (head > tail ? head : _capacity) - tail;  // contiguous bytes
+    if (size > max_bytes - drained) size = max_bytes - drained;
+    out.write(&_buffer[tail], size);
+    drained += size;
+    tail    += size;
+    if (tail == _capacity) tail = 0;
+  }
+  ez_memory_barrier();  // records read before their bytes are released
+  _tail = tail;
+  return drained;
+} // End drain
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Bytes of trace waiting to be drained.
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+uint16_t Switch_trace::available() {
+  uint16_t head = _head;
+  uint16_t tail = _tail;
+  return head >= tail ? head - tail : head + _capacity - tail;
+} // End available
@@ -0,0 +1,104 @@
+// Arduino Switch Library - switch pin trace recorder.
+//
+// Records the contact transitions of chosen switches, as seen by the
+// read functions, into a small ring buffer of compact, timestamped
+// records, for draining to a stream (eg Serial) by the main loop. The
+// trace may be replayed off-device through the debounce logic, see
+// extras/native/ez_switch_replay.cpp, eg to choose debounce periods, or
+// to check library changes against traces of real switches.
+//
+// A recorder is given its buffer by 'begin', the switches to record by
+// 'record_switch' or 'record_all', and is attached to a Switches
+// instance by Switches::set_trace, eg
+//   uint8_t my_trace_buffer[256];
+//   Switch_trace my_trace;
+//   my_trace.begin(my_trace_buffer, sizeof(my_trace_buffer));
+//   my_trace.record_all();
+//   my_switches.set_trace(&my_trace);
+//   my_switches.write_trace_header(Serial);
+// then each time round loop()
+//   my_trace.drain(Serial);
+// RAM used is the buffer plus 116 bytes (AVR), whatever the trace length.
+//
+// Trace format, multi-byte values little endian:
+//   header, see Switches::write_trace_header:
+//     4 bytes  'E', 'Z', 'T', format version 1
+//     1 byte   number of switches, n
+//     uint32   trace start time, microsecs
+//     n times, one per switch_id:
+//       1 byte switch_type, 1 byte button mode, 1 byte switch_on_value,
+//       uint16 debounce period, millisecs
+//       (switch_type trace_no_switch (255), and all else 0, for the
+//       switch_ids of removed switches, see Switches::remove_switch)
+//   records, to end of stream:
+//     1 byte   switch_id
+//     varint   (delta << 1) | contact, 'delta' being microsecs since the
+//              previous record (the first since the trace start) and
+//              'contact' 1 if the switch is 'on'
+//   or
+//     1 byte   trace_lost (255)
+//     varint   number of records lost, the buffer being full
+// A varint is 7 bits per byte, least significant first, the top bit set
+// on all but the last byte. Most records are 3 or 4 bytes.
+//
+// The first reading of each recorded switch is always recorded, giving
+// its starting contact. Transitions are only seen when the switch is
+// read, so the trace resolution is that of the scan. Gaps between
+// records of over 71 minutes (2^32 microsecs) are not representable.
+//
+// As the event queue, the recorder is single producer (the read
+// functions)/single consumer (drain), each end used from one context.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_switch_trace_h
+#define ez_switch_trace_h
+#include <Arduino.h>
+
+#define trace_success         0      // trace buffer established
+#define trace_failure        -1      // trace buffer too small, under trace_min_buffer bytes
+#define trace_min_buffer     16      // smallest buffer, bytes
+#define trace_version         1      // trace format version
+#define trace_lost          255      // record of records lost
+#define trace_no_switch     255      // header switch_type of a removed switch
+
+class Switch_trace
+{
+  public:
+    int      begin         (uint8_t *buffer, uint16_t capacity);
+    void     record_switch (uint8_t switch_id, bool record = true);
+    void     record_all    ();
+    void     start         (uint32_t time_us);
+    bool     is_change     (uint8_t switch_id, bool sw_on) {
+      uint8_t  word = switch_id >> 5;
+      uint32_t bit  = (uint32_t)1 << (switch_id & 31);
+      return (_recorded[word] & bit) != 0 &&
+             ((_seen[word] & bit) == 0 || ((_contact[word] & bit) != 0) != sw_on);
+    }
+    void     record        (uint8_t switch_id, bool sw_on, uint32_t time_us);
+    uint16_t drain         (Print &out, uint16_t max_bytes = 0xFFFF);
+    uint16_t available     ();
+    bool     is_enabled    () { return _buffer != NULL; }
+
+    uint32_t          start_time = 0;  // trace start, microsecs, see start
+    volatile uint16_t overflows  = 0;  // records lost as buffer full
+
+  private:
+    bool     put_record    (uint8_t id, uint32_t value, uint8_t low_bit);
+
+    uint8_t          *_buffer   = NULL;  // user supplied trace storage
+    uint16_t          _capacity = 0;
+    volatile uint16_t _head     = 0;     // next byte to write, producer owned
+    volatile uint16_t _tail     = 0;     // next byte to drain, consumer owned
+    uint32_t _last_time = 0;             // time of the latest record kept
+    uint16_t _lost      = 0;             // records lost since the latest kept
+    uint32_t _recorded[8] = {};          // switches recorded, one bit per switch_id
+    uint32_t _seen[8]     = {};          // switches read since start
+    uint32_t _contact[8]  = {};          // latest reading of each switch, set if 'on'
+};
+
+#endif
@@ -0,0 +1,65 @@
+// Arduino Switch Library - bit-sliced (vertical counter) debounce engine.
+//
+// Debounces up to 32 (W = uint32_t) or 64 (W = uint64_t) switches at
+// once, one switch per bit, with a handful of bitwise operations per
+// sample. Each switch has a 2 bit counter held 'vertically' across the
+// two counter words, counting consecutive samples that differ from the
+// debounced state. When 4 consecutive samples differ, the debounced
+// state of that switch flips; any sample agreeing with the debounced
+// state restarts its count.
+//
+// Samples are expected at a regular interval, so the debounce period is
+// 3 sample intervals from the first of the 4 differing samples.
+//
+// Used by Switches when the 'vertical_debounce' engine is selected (see
+// Switches::set_debounce_engine), but may also be used standalone.
+//
+// Ron Bentley, Stafford (UK), October 2026
+//
+// This example and code is in the public domain and
+// may be used without restriction and without warranty.
+//
+
+#ifndef ez_vertical_debounce_h
+#define ez_vertical_debounce_h
+#include <Arduino.h>
+
+#define vertical_samples      4      // consecutive samples needed to flip a switch's state
+
+template <typename W>
+struct Vertical_debouncer {
+  W state;   // debounced state, bit set = switch 'on'
+  W cnt0;    // low bit of each switch's sample counter
+  W cnt1;    // high bit of each switch's sample counter
+
+  void reset(W initial_state) {
+    state = initial_state;
+    cnt0  = 0;
+    cnt1  = 0;
+  }
+
+  // Clear the given bits, as if their switches had never been 'on'.
+  void clear(W bits) {
+    state &= ~bits;
+    cnt0  &= ~bits;
+    cnt1  &= ~bits;
+  }
+
+  // Present the next sample of all switches, bit set = switch 'on'.
+  // Returns the bits whose debounced state flipped with this sample.
+  W update(W sample) {
+    W delta = sample ^ state;          // switches differing from their debounced state
+    cnt1    = (cnt1 ^ cnt0) & delta;   // count up those differing, clear the others
+    cnt0    = ~cnt0 & delta;
+    W flips = delta & ~(cnt0 | cnt1);  // count wrapped, ie 4 differing samples
+    state  ^= flips;
+    return flips;
+  }
+
+  // Bits currently counting towards a flip, ie switches in transition.
+  W in_transition() const {
+    return cnt0 | cnt1;
+  }
+};
+
+#endif